@@ -2,13 +2,79 @@
 #include "3RoundsTrailCores.h"
 #include "KK_trailCores.h"
 #include "backwardInKernelExtension.h"
+#include "extensionCache.h"
 #include "forwardExtension.h"
 #include "forwardInKernelExtension.h"
+#include "memoryAccounting.h"
 #include "mixedStateIterator.h"
+#include "progressReporter.h"
+#include "searchPhase.h"
+#include "trace.h"
 #include "trailCore.h"
+#include "trailCoreQueue.h"
+#include <mutex>
+#include <thread>
 
 enum Parity{N, K};
 
+typedef set<TrailCore, less<TrailCore>, 
+            AccountedAllocator<TrailCore, memoryTrailSets>> TrailCoreSet; 
+
+/** The maximum number of run files merged at once. */
+#define MAX_SPILLED_RUNS 64
+
+/** The minimum number of trail cores of a run file. When the other 
+  * structures alone exceed the budget, it keeps the runs from shrinking to
+  * one trail core each. 
+  */
+#define MIN_SPILLED_RUN_SIZE 4096
+
+/** It saves the trail cores of @a trailsSet in the file @a fileName, in 
+  * ascending order, and empties the set. 
+  */
+static void spillTrailCores(TrailCoreSet& trailsSet, const string& fileName)
+{
+    ofstream fout(fileName.c_str());
+    for (TrailCoreSet::const_iterator it = trailsSet.begin(); it != trailsSet.end(); it++)
+        (*it).save(fout); 
+    trailsSet.clear(); 
+}
+
+/** It merges the sorted files of trail cores @a fileNames into @a fout, 
+  * keeping one trail core per class of equal trail cores, and removes the 
+  * files if @a removeFiles is true. 
+  */
+static void mergeTrailCores(const vector<string>& fileNames, ostream& fout, 
+                            bool removeFiles = true)
+{
+    vector<TrailFileIterator*> runs; 
+    for (unsigned int i = 0; i < fileNames.size(); i++)
+        runs.push_back(new TrailFileIterator(fileNames[i])); 
+    bool first = true; 
+    TrailCore last; 
+    while (true) {
+        int smallest = -1; 
+        for (unsigned int i = 0; i < runs.size(); i++) {
+            if (!runs[i]->isEnd() && (smallest == -1 || **runs[i] < **runs[smallest]))
+                smallest = i; 
+        }
+        if (smallest == -1)
+            break; 
+        const TrailCore& trail = **runs[smallest]; 
+        if (first || last < trail) {
+            trail.save(fout); 
+            last = trail; 
+            first = false; 
+        }
+        ++(*runs[smallest]); 
+    }
+    for (unsigned int i = 0; i < runs.size(); i++) {
+        delete runs[i]; 
+        if (removeFiles)
+            remove(fileNames[i].c_str()); 
+    }
+}
+
 
 void checkTrailAndParity(string fileNameIn, vector<Parity> parity)
 {
@@ -20,7 +86,10 @@ void checkTrailAndParity(string fileNameIn, vector<Parity> parity)
     ofstream fout(fileNameOut.c_str());
    
     // It removes the trail cores that are 
-    set<TrailCore> trailsSet;
+    // When the memory budget is exceeded, the set is spilled to a sorted run 
+    // file, and the runs are merged at the end. 
+    TrailCoreSet trailsSet;
+    vector<string> runFileNames; 
     ifstream fin(fileNameIn); 
     TrailFileIterator trails(fileNameIn);
     for (; !trails.isEnd(); ++trails) {
@@ -42,18 +111,55 @@ void checkTrailAndParity(string fileNameIn, vector<Parity> parity)
             }
         }
         trailsSet.insert(trail);
+        if (trailsSet.size() >= MIN_SPILLED_RUN_SIZE 
+            && MemoryAccounting::isOverBudget(memoryTrailSets)) {
+            stringstream runFileName; 
+            runFileName << fileNameOut << "-run-" << runFileNames.size(); 
+            runFileNames.push_back(runFileName.str()); 
+            spillTrailCores(trailsSet, runFileNames.back()); 
+            if (runFileNames.size() == MAX_SPILLED_RUNS) {
+                string mergedFileName = fileNameOut + "-run-merged"; 
+                ofstream fmerged((mergedFileName + "-tmp").c_str()); 
+                mergeTrailCores(runFileNames, fmerged); 
+                fmerged.close(); 
+                rename((mergedFileName + "-tmp").c_str(), mergedFileName.c_str()); 
+                runFileNames.assign(1, mergedFileName); 
+            }
+        }
     } 
-    set<TrailCore>::const_iterator it;
-    for (it = trailsSet.begin(); it != trailsSet.end(); it++) {
-        TrailCore trail = *it;
-        (*it).save(fout); 
+    if (runFileNames.empty()) {
+        TrailCoreSet::const_iterator it;
+        for (it = trailsSet.begin(); it != trailsSet.end(); it++)
+            (*it).save(fout); 
+    } else {
+        if (!trailsSet.empty()) {
+            runFileNames.push_back(fileNameOut + "-run-last"); 
+            spillTrailCores(trailsSet, runFileNames.back()); 
+        }
+        mergeTrailCores(runFileNames, fout); 
     }
     fout.close(); 
     produceHumanReadableFile(fileNameOut);
 }
 
+/** It merges the sorted catalog <name>-<T3Old>-verif of a previous run and 
+  * the catalog <name>-<T3Old>-<T3>-verif of the trail cores of weight in 
+  * (T3Old, T3] into <name>-<T3>-verif. The two catalogs are kept. 
+  */
+static void mergeWithPreviousCatalog(const string& name, int T3Old, int T3)
+{
+    stringstream fileOld, fileBand, fileOut; 
+    fileOld << name << "-" << T3Old << "-verif"; 
+    fileBand << name << "-" << T3Old << "-" << T3 << "-verif"; 
+    fileOut << name << "-" << T3 << "-verif"; 
+    ofstream fout(fileOut.str().c_str()); 
+    mergeTrailCores(vector<string> {fileOld.str(), fileBand.str()}, fout, false); 
+    fout.close(); 
+    produceHumanReadableFile(fileOut.str());
+}
+
 KN_TrailCores::KN_TrailCores(int T3, int T1)
-:T3(T3), T1(T1) 
+:T3(T3), T1(T1), T3Old(0), cachedExtensions(false) 
 {
     stringstream stream_K_TrailCores; 
     stream_K_TrailCores << "K-trailCores-T1-";
@@ -76,12 +182,34 @@ KN_TrailCores::KN_TrailCores(int T3, int T1)
     fileInKernelExtension = streamInKernelExtension.str();
 }
 
+void KN_TrailCores::searchFrom(int aT3Old)
+{
+    if (!(aT3Old < T3))
+        throw Exception("The previous bound must be lower than T3."); 
+    T3Old = aT3Old; 
+
+    stringstream streamForwardExtension; 
+    streamForwardExtension << "KN-trailCores-fromForwardExtension-T3-";
+    streamForwardExtension << T3Old << "-" << T3; 
+    streamForwardExtension << "-T1-"; 
+    streamForwardExtension << T1; 
+    fileForwardExtension = streamForwardExtension.str();
+
+    stringstream streamInKernelExtension; 
+    streamInKernelExtension << "KN-trailCores-fromInKernelExtension-T3-";
+    streamInKernelExtension << T3Old << "-" << T3; 
+    streamInKernelExtension << "-T1-"; 
+    streamInKernelExtension << T1;
+    fileInKernelExtension = streamInKernelExtension.str();
+}
+
 void KN_TrailCores::K_TrailCores()
 {
     int maxCost; 
     time_t start, ending; 
     ofstream fout(file_K_TrailCores.c_str());  
     time(&start); 
+    SearchPhase searchPhase("K_TrailCores", PerfCounters::treeTraversal);
 
     // The cost is always even
     if (T1 % 2 == 0)
@@ -89,9 +217,13 @@ void KN_TrailCores::K_TrailCores()
     else 
         maxCost = max(0, T1 - 1); 
 
-    traverse_K_TrailCoresTree(maxCost, 1, 0, fout); 
+    TraversalStatistics statistics; 
+    traverse_K_TrailCoresTree(maxCost, 1, 0, fout, &statistics); 
+    TRAVERSAL_STATISTICS_ONLY(saveTraversalStatistics(file_K_TrailCores + "-statistics.json", 
+                                                      {{"K_TrailCore_Iterator", statistics}});)
     time(&ending);
     double time = difftime(ending, start);
+    SearchStep reportStep("report", PerfCounters::output);
     fout.close();
     produceHumanReadableFileTwoRoundTrailCores(file_K_TrailCores, 1, 0, true, time);
 }
@@ -101,6 +233,7 @@ void KN_TrailCores::KN_FromInKernelExtension()
 
     time_t start, ending; 
     time(&start);
+    SearchPhase searchPhase("KN_FromInKernelExtension", PerfCounters::treeTraversal);
     ofstream fout(fileInKernelExtension.c_str());
 
     unsigned int alpha = 1; 
@@ -117,9 +250,14 @@ void KN_TrailCores::KN_FromInKernelExtension()
     TroikaState stateD; 
 
     unsigned int cpt = 0; 
-    BareStateIterator bareStates(colSet, bareStateCache, costFBareState, maxCost2Rounds, true);
+    TRAVERSAL_STATISTICS_ONLY(TraversalStatistics tritsStatistics;)
+    BareStateIterator bareStates(colSet, bareStateCache, costFBareState, maxCost2Rounds, false);
+    progress.setNrFirstLevelUnits(bareStates.countFirstLevelUnits());
+    ++bareStates;
     for (; !bareStates.isEnd(); ++bareStates) {
-        BareState bareState = *bareStates;
+        progress.addNodes();
+        progress.setPrefix(bareStates.nrFirstLevelNodes);
+        const BareState& bareState = *bareStates;
         if (bareState.valid) {
 
             MixedTrailCoreCache mixedCache(bareState);
@@ -128,10 +266,15 @@ void KN_TrailCores::KN_FromInKernelExtension()
             N_TrailCore_Iterator iteratorTrits(activeTritsSet, mixedCache,
                                                costFTrits, maxCost2Rounds, false);  
             for (; !iteratorTrits.isEnd(); ++iteratorTrits) {
-                TwoRoundTrailCore trailCores = *iteratorTrits;
+                const TwoRoundTrailCore& trailCores = *iteratorTrits;
+                progress.addNodes();
+                TraceSpan trailSpan("trail core", TraceSpan::sampling);
 
-                long double aMaxWeightExtension = T3 - trailCores.wB;
-                BackwardInKernelExtensionPreparation prep(aMaxWeightExtension, trailCores.activeA);
+                WeightBound aMaxWeightExtension = WeightBound(T3) - Weight(trailCores.wB);
+                SearchStep preparationStep("preparation", PerfCounters::inKernelExtension);
+                BackwardInKernelExtensionPreparation prep(aMaxWeightExtension, trailCores.getActiveA());
+                prep.minWeightExtension = WeightBound(T3Old) - Weight(trailCores.wB); 
+                preparationStep.stop();
 
                 cpt++; 
                 if (cpt % 10000 == 0 )
@@ -139,82 +282,131 @@ void KN_TrailCores::KN_FromInKernelExtension()
            
                 if (prep.possible) {
 
-                    for (; !trailCores.statesB.isEnd(); ++trailCores.statesB) {
-                        stateD = *trailCores.statesB; 
+                    SearchStep expansionStep("pattern expansion", PerfCounters::stateExpansion);
+                    TroikaStateIterator statesB = trailCores.getStatesB(); 
+                    for (; !statesB.isEnd(); ++statesB) {
+                        stateD = *statesB; 
                         stateC.setInvL(stateD);
+                        SearchStep extensionsStep("extensions", PerfCounters::inKernelExtension);
                         BackwardInKernelExtensionIterator extensions(prep, stateC);
                         for (; !extensions.isEnd(); ++extensions) {
-                            BackwardInKernelExtension ext = *extensions;
+                            const BackwardInKernelExtension& ext = *extensions;
                             TrailCore trail(ext.stateA, ext.stateB, stateC, stateD, ext.wMinRevA, ext.wBC, trailCores.wB); // TODO changer nom wA et wB pour wMinRev, wMinDir  
                             trail.save(fout);       
+                            progress.addTrail(trail.weight);
                         }
                     }
                 }
             }
+            TRAVERSAL_STATISTICS_ONLY(tritsStatistics += iteratorTrits.statistics;)
         }
     }
     time(&ending);
+    TRAVERSAL_STATISTICS_ONLY(saveTraversalStatistics(fileInKernelExtension + "-statistics.json", 
+                                                      {{"BareStateIterator", bareStates.statistics}, 
+                                                       {"N_TrailCore_Iterator", tritsStatistics}});)
     double time = difftime(ending, start);
+    SearchStep reportStep("report", PerfCounters::output);
     fout.close();
     produceHumanReadableFile(fileInKernelExtension, true, time);
 }
 
+void KN_TrailCores::useShared_K_TrailCores(const Shared_K_TrailCores& shared)
+{
+    file_K_TrailCores = shared.getFileName(); 
+}
+
 void KN_TrailCores::KN_FromForwardExtension()
 {
     unsigned int cpt = 0; 
     time_t start, ending; 
     time(&start);
+    SearchPhase searchPhase("KN_FromForwardExtension", PerfCounters::input);
     ofstream fout(fileForwardExtension.c_str());
 
     try {
-        ofstream fout(fileForwardExtension.c_str());
         TrailFileIterator trailsIn(file_K_TrailCores); 
+        ExtensionCache cache; 
+        vector<ForwardExtension> extensions; 
         for (; !trailsIn.isEnd(); ++trailsIn) {
-            TrailCore trailToExtend = *trailsIn;
-            long double maxWeightExtension = T3 - (long double)trailToExtend.wMinRev; 
-            ForwardExtensionPreparation prep(trailToExtend.differences.back(), maxWeightExtension);
-            ForwardExtensionIterator extensions(prep, trailToExtend.differences.back());
             cpt++; 
+            progress.addNodes();
+            if (cpt % 1024 == 0)
+                progress.setFractionDone(trailsIn.getFractionRead());
             if (cpt % 1000000 == 0 )
                 cout << cpt << "-th trail to extend " << endl; 
-            for (; !extensions.isEnd(); ++extensions) {
-                ForwardExtension extension = *extensions;
-                if (!extension.stateD.isInKernel()) {
-                    TrailCore extendedTrail(trailToExtend, extension);
-                    extendedTrail.save(fout); 
-                }
-            } 
+            forwardExtend(*trailsIn, cachedExtensions ? &cache : NULL, extensions, fout); 
         }
     } catch (Exception e) {
         cout << e.reason << endl; 
     }
     time(&ending);
     double time = difftime(ending, start);
+    SearchStep reportStep("report", PerfCounters::output);
     fout.close();
     produceHumanReadableFile(fileForwardExtension, true, time);
 }
 
+void KN_TrailCores::forwardExtend(const TrailCore& trailToExtend, ExtensionCache* cache, 
+                                  vector<ForwardExtension>& extensions, ostream& fout)
+{
+    if (trailToExtend.wMinRev > Weight(T1))
+        return; 
+    TraceSpan trailSpan("trail core", TraceSpan::sampling);
+    WeightBound maxWeightExtension = WeightBound(T3) - trailToExtend.wMinRev; 
+    WeightBound minWeightExtension = WeightBound(T3Old) - trailToExtend.wMinRev; 
+    if (cache != NULL) {
+        SearchStep extensionsStep("extensions", PerfCounters::forwardExtension);
+        cache->getForwardExtensions(trailToExtend.differences.back(), maxWeightExtension, extensions);
+        vector<ForwardExtension>::const_iterator extension; 
+        for (extension = extensions.begin(); extension != extensions.end(); ++extension) {
+            if (!extension->stateD.isInKernel() && extension->isAboveWeight(minWeightExtension)) {
+                TrailCore extendedTrail(trailToExtend, *extension);
+                extendedTrail.save(fout); 
+                progress.addTrail(extendedTrail.weight);
+            }
+        } 
+        return; 
+    }
+    SearchStep preparationStep("preparation", PerfCounters::forwardExtension);
+    ForwardExtensionPreparation prep(trailToExtend.differences.back(), maxWeightExtension);
+    prep.minWeightExtension = minWeightExtension; 
+    preparationStep.stop();
+    SearchStep extensionsStep("extensions", PerfCounters::forwardExtension);
+    ForwardExtensionIterator extensionsIt(prep, trailToExtend.differences.back());
+    for (; !extensionsIt.isEnd(); ++extensionsIt) {
+        if (!(*extensionsIt).stateD.isInKernel()) {
+            TrailCore extendedTrail(trailToExtend, *extensionsIt);
+            extendedTrail.save(fout); 
+            progress.addTrail(extendedTrail.weight);
+        }
+    } 
+}
+
 void KN_TrailCores::nrTrailsFound() 
 {
-    stringstream fileIn, fileOut; 
+    stringstream fileOut; 
     
-    fileOut << "KN-" << T3; 
+    fileOut << "KN-"; 
+    if (T3Old > 0)
+        fileOut << T3Old << "-"; 
+    fileOut << T3; 
     ofstream fout(fileOut.str());
 
-    fileIn << "KN-trailCores-fromForwardExtension-T3-" << T3 << "-T1-" << T1; 
-    TrailFileIterator trails(fileIn.str()); 
+    TrailFileIterator trails(fileForwardExtension); 
     for (; ! trails.isEnd(); ++trails)
         (*trails).save(fout);
-    fileIn.clear(); fileIn.str(""); fileIn << "KN-trailCores-fromInKernelExtension-T3-" << T3 << "-T1-" << T1; 
-    TrailFileIterator trails_(fileIn.str()); 
+    TrailFileIterator trails_(fileInKernelExtension); 
     for (; ! trails_.isEnd(); ++trails_)
         (*trails_).save(fout);
     fout.close();
     checkTrailAndParity(fileOut.str(), vector<Parity> {K, N});
+    if (T3Old > 0)
+        mergeWithPreviousCatalog("KN", T3Old, T3); 
 }
 
 NK_TrailCores::NK_TrailCores(int T3, int T1):
-    T3(T3), T1(T1)
+    T3(T3), T1(T1), T3Old(0), cachedExtensions(false)
 {
     stringstream streamInKernelExtension; 
      streamInKernelExtension << "NK-trailCores-fromInKernelExtension-T3-";
@@ -237,21 +429,47 @@ NK_TrailCores::NK_TrailCores(int T3, int T1):
      file_K_TrailCores = stream_K_TrailCores.str();
 }
 
+void NK_TrailCores::searchFrom(int aT3Old)
+{
+    if (!(aT3Old < T3))
+        throw Exception("The previous bound must be lower than T3."); 
+    T3Old = aT3Old; 
+
+    stringstream streamInKernelExtension; 
+    streamInKernelExtension << "NK-trailCores-fromInKernelExtension-T3-";
+    streamInKernelExtension << T3Old << "-" << T3; 
+    streamInKernelExtension << "-T1-"; 
+    streamInKernelExtension << T1;
+    fileInKernelExtension = streamInKernelExtension.str(); 
+
+    stringstream streamBackwardExtension; 
+    streamBackwardExtension << "NK-trailCores-fromBackwardExtension-T3-";
+    streamBackwardExtension << T3Old << "-" << T3; 
+    streamBackwardExtension << "-T1-"; 
+    streamBackwardExtension << T1; 
+    fileBackwardExtension = streamBackwardExtension.str();
+}
+
 void NK_TrailCores::K_TrailCores()
 {
     int maxCost; 
     time_t start, ending; 
     ofstream fout(file_K_TrailCores.c_str());
     time(&start);
+    SearchPhase searchPhase("K_TrailCores", PerfCounters::treeTraversal);
 
     if (T1 % 2 == 0) // The cost is always even
         maxCost = T1; 
     else 
         maxCost = max(0, T1 - 1); 
 
-    traverse_K_TrailCoresTree(T1, 0, 1, fout); 
+    TraversalStatistics statistics; 
+    traverse_K_TrailCoresTree(T1, 0, 1, fout, &statistics); 
+    TRAVERSAL_STATISTICS_ONLY(saveTraversalStatistics(file_K_TrailCores + "-statistics.json", 
+                                                      {{"K_TrailCore_Iterator", statistics}});)
     time(&ending);
     double time = difftime(ending, start);
+    SearchStep reportStep("report", PerfCounters::output);
     fout.close();
     produceHumanReadableFileTwoRoundTrailCores(file_K_TrailCores, 0, 1, true, time);
 }
@@ -261,6 +479,7 @@ void NK_TrailCores::NK_FromInKernelExtension()
 
     time_t start, ending; 
     time(&start);
+    SearchPhase searchPhase("NK_FromInKernelExtension", PerfCounters::treeTraversal);
     ofstream fout(fileInKernelExtension.c_str());
 
     unsigned int alpha = 1; 
@@ -278,9 +497,14 @@ void NK_TrailCores::NK_FromInKernelExtension()
 
     unsigned int cpt = 0; 
 
-    BareStateIterator bareStates(colSet, bareStateCache, costFBareState, maxCost2Rounds, true);
+    TRAVERSAL_STATISTICS_ONLY(TraversalStatistics tritsStatistics;)
+    BareStateIterator bareStates(colSet, bareStateCache, costFBareState, maxCost2Rounds, false);
+    progress.setNrFirstLevelUnits(bareStates.countFirstLevelUnits());
+    ++bareStates;
     for (; !bareStates.isEnd(); ++bareStates) {
-        BareState bareState = *bareStates;
+        progress.addNodes();
+        progress.setPrefix(bareStates.nrFirstLevelNodes);
+        const BareState& bareState = *bareStates;
         if (bareState.valid) {
 
             MixedTrailCoreCache mixedCache(bareState);
@@ -289,93 +513,347 @@ void NK_TrailCores::NK_FromInKernelExtension()
             N_TrailCore_Iterator iteratorTrits(activeTritsSet, mixedCache,
                                                costFTrits, maxCost2Rounds, false);  
             for (; !iteratorTrits.isEnd(); ++iteratorTrits) {
-                TwoRoundTrailCore trailCores = *iteratorTrits;
-
-                long double maxWeightExtension = T3 - trailCores.wA;
-                ForwardInKernelExtensionPreparation prep(maxWeightExtension, trailCores.activeB);
+                const TwoRoundTrailCore& trailCores = *iteratorTrits;
+                progress.addNodes();
+                TraceSpan trailSpan("trail core", TraceSpan::sampling);
+
+                WeightBound maxWeightExtension = WeightBound(T3) - Weight(trailCores.wA);
+                WeightBound minWeightExtension = WeightBound(T3Old) - Weight(trailCores.wA);
+                SearchStep preparationStep("preparation", PerfCounters::inKernelExtension);
+                ForwardInKernelExtensionPreparation prep(maxWeightExtension, trailCores.getActiveB());
+                preparationStep.stop();
                 cpt ++; 
                 if (cpt % 10000 == 0)
                     cout << cpt << "-th trail to extend" << endl; 
                 if (prep.couldBeExtended()) {
 
-                    for (; !trailCores.statesB.isEnd(); ++trailCores.statesB) {
-                        stateB = *trailCores.statesB; 
+                    SearchStep expansionStep("pattern expansion", PerfCounters::stateExpansion);
+                    TroikaStateIterator statesB = trailCores.getStatesB(); 
+                    for (; !statesB.isEnd(); ++statesB) {
+                        stateB = *statesB; 
                         stateA.setInvL(stateB);
                         TrailCore trailToExtend(stateA, stateB, trailCores.wA, trailCores.wB);
 
 
+                        SearchStep extensionsStep("extensions", PerfCounters::inKernelExtension);
                         ForwardInKernelExtensionIterator extensions(prep, stateB); 
                         for (; !extensions.isEnd(); ++extensions) {
-                            ForwardExtension ext = *extensions;
+                            const ForwardExtension& ext = *extensions;
+                            if (!ext.isAboveWeight(minWeightExtension))
+                                continue; 
                             TrailCore extendedTrailCore(trailToExtend, ext); 
                             extendedTrailCore.save(fout);
+                            progress.addTrail(extendedTrailCore.weight);
                             
                         }
                     }
                 }
             }
+            TRAVERSAL_STATISTICS_ONLY(tritsStatistics += iteratorTrits.statistics;)
         }
     }
     time(&ending);
+    TRAVERSAL_STATISTICS_ONLY(saveTraversalStatistics(fileInKernelExtension + "-statistics.json", 
+                                                      {{"BareStateIterator", bareStates.statistics}, 
+                                                       {"N_TrailCore_Iterator", tritsStatistics}});)
     cout << cpt << " trails extended" << endl; 
     double time = difftime(ending, start);
+    SearchStep reportStep("report", PerfCounters::output);
     fout.close();
     produceHumanReadableFile(fileInKernelExtension, true, time);
 }
  
+void NK_TrailCores::useShared_K_TrailCores(const Shared_K_TrailCores& shared)
+{
+    file_K_TrailCores = shared.getFileName(); 
+}
+
 void NK_TrailCores::NK_FromBackwardExtension()
 {
     unsigned int cpt = 0; 
     time_t start, ending; 
     time(&start);
+    SearchPhase searchPhase("NK_FromBackwardExtension", PerfCounters::input);
+    ofstream fout(fileBackwardExtension.c_str()); 
     try {
         TrailFileIterator trailsIn(file_K_TrailCores);
-        ofstream fout(fileBackwardExtension.c_str()); 
+        ExtensionCache cache; 
+        vector<BackwardExtension> extensions; 
 
         for (; !trailsIn.isEnd(); ++trailsIn) {
-            TrailCore trailToExtend = *trailsIn; 
-            long double maxWeightExtension = T3 - (long double)trailToExtend.wMinDir;
-            BackwardExtensionPreparation prep(trailToExtend.differences[0], maxWeightExtension);
-            BackwardExtensionIterator extensions(prep, trailToExtend.differences[0]);
             cpt++; 
+            progress.addNodes();
+            if (cpt % 1024 == 0)
+                progress.setFractionDone(trailsIn.getFractionRead());
             if (cpt % 1000000 == 0 )
                 cout << cpt << "-th trail to extend" << endl; 
-            for (; !extensions.isEnd(); ++extensions) {
-                BackwardExtension extension = *extensions;
-                if (!extension.stateB.isInKernel()) {
-                    TrailCore extendedTrail(trailToExtend, extension);
-                    extendedTrail.save(fout);
-                }
-            }
+            backwardExtend(*trailsIn, cachedExtensions ? &cache : NULL, extensions, fout); 
         }
     } catch(Exception e) {
         cout << e.reason << endl; 
     }
     time(&ending);
     double time = difftime(ending, start);
+    SearchStep reportStep("report", PerfCounters::output);
+    fout.close(); 
     produceHumanReadableFile(fileBackwardExtension, true, time);
 }
 
+void NK_TrailCores::backwardExtend(const TrailCore& trailToExtend, ExtensionCache* cache, 
+                                   vector<BackwardExtension>& extensions, ostream& fout)
+{
+    if (trailToExtend.wMinDir > Weight(T1))
+        return; 
+    TraceSpan trailSpan("trail core", TraceSpan::sampling);
+    WeightBound maxWeightExtension = WeightBound(T3) - trailToExtend.wMinDir;
+    WeightBound minWeightExtension = WeightBound(T3Old) - trailToExtend.wMinDir;
+    if (cache != NULL) {
+        SearchStep extensionsStep("extensions", PerfCounters::backwardExtension);
+        cache->getBackwardExtensions(trailToExtend.differences[0], maxWeightExtension, extensions);
+        vector<BackwardExtension>::const_iterator extension; 
+        for (extension = extensions.begin(); extension != extensions.end(); ++extension) {
+            if (!extension->stateB.isInKernel() && extension->isAboveWeight(minWeightExtension)) {
+                TrailCore extendedTrail(trailToExtend, *extension);
+                extendedTrail.save(fout);
+                progress.addTrail(extendedTrail.weight);
+            }
+        }
+        return; 
+    }
+    SearchStep preparationStep("preparation", PerfCounters::backwardExtension);
+    BackwardExtensionPreparation prep(trailToExtend.differences[0], maxWeightExtension);
+    prep.minWeightExtension = minWeightExtension; 
+    preparationStep.stop();
+    SearchStep extensionsStep("extensions", PerfCounters::backwardExtension);
+    BackwardExtensionIterator extensionsIt(prep, trailToExtend.differences[0]);
+    for (; !extensionsIt.isEnd(); ++extensionsIt) {
+        if (!(*extensionsIt).stateB.isInKernel()) {
+            TrailCore extendedTrail(trailToExtend, *extensionsIt);
+            extendedTrail.save(fout);
+            progress.addTrail(extendedTrail.weight);
+        }
+    }
+}
+
 void NK_TrailCores::nrTrailsFound() 
 {
-    stringstream fileIn, fileOut; 
+    stringstream fileOut; 
     
-    fileOut << "NK-" << T3; 
+    fileOut << "NK-"; 
+    if (T3Old > 0)
+        fileOut << T3Old << "-"; 
+    fileOut << T3; 
     ofstream fout(fileOut.str());
 
-    fileIn << "NK-trailCores-fromBackwardExtension-T3-" << T3 << "-T1-" << T1; 
-    TrailFileIterator trails(fileIn.str()); 
+    TrailFileIterator trails(fileBackwardExtension); 
     for (; ! trails.isEnd(); ++trails)
         (*trails).save(fout);
-    fileIn.clear(); fileIn.str(""); fileIn << "NK-trailCores-fromInKernelExtension-T3-" << T3 << "-T1-" << T1; 
-    TrailFileIterator trails_(fileIn.str()); 
+    TrailFileIterator trails_(fileInKernelExtension); 
     for (; ! trails_.isEnd(); ++trails_)
         (*trails_).save(fout);
     fout.close();
     checkTrailAndParity(fileOut.str(), vector<Parity> {N, K});
+    if (T3Old > 0)
+        mergeWithPreviousCatalog("NK", T3Old, T3); 
+}
+
+Shared_K_TrailCores::Shared_K_TrailCores(int T1)
+: T1(T1)
+{
+    stringstream stream_K_TrailCores; 
+    stream_K_TrailCores << "K-trailCores-T1-";
+    stream_K_TrailCores << T1; 
+    file_K_TrailCores = stream_K_TrailCores.str();
+}
+
+/** The cost function of the union of the 2-round trail cores of 
+  * KN_TrailCores::K_TrailCores (wMinRev(A) ≤ maxCost) and of
+  * NK_TrailCores::K_TrailCores (wMinDir(B) ≤ maxCost). 
+  */ 
+static TwoRoundTrailCoreCostFunction getSharedCostFunction(unsigned int maxCost)
+{
+    return TwoRoundTrailCoreCostFunction(1, 0, maxCost, 0, 1, maxCost); 
+}
+
+void Shared_K_TrailCores::K_TrailCores()
+{
+    time_t start, ending; 
+    ofstream fout(file_K_TrailCores.c_str());  
+    time(&start); 
+    SearchPhase searchPhase("K_TrailCores", PerfCounters::treeTraversal);
+
+    // The cost is always even
+    unsigned int maxCost = max(0, T1 - (T1 % 2)); 
+    TraversalStatistics statistics; 
+    traverse_K_TrailCoresTree(getSharedCostFunction(maxCost), maxCost, 
+                              [&fout](const TrailCore& trail) { trail.save(fout); }, 
+                              &statistics); 
+    TRAVERSAL_STATISTICS_ONLY(saveTraversalStatistics(file_K_TrailCores + "-statistics.json", 
+                                                      {{"K_TrailCore_Iterator", statistics}});)
+    time(&ending);
+    double time = difftime(ending, start);
+    SearchStep reportStep("report", PerfCounters::output);
+    fout.close();
+    produceHumanReadableFileTwoRoundTrailCores(file_K_TrailCores, 1, 1, true, time);
+}
+
+void Shared_K_TrailCores::extend(KN_TrailCores* KN, NK_TrailCores* NK)
+{
+    if ((KN != NULL && KN->T1 != T1) || (NK != NULL && NK->T1 != T1))
+        throw Exception("Shared_K_TrailCores::extend: the trail cores are generated for another T1."); 
+    time_t start, ending; 
+    time(&start);
+    SearchPhase searchPhase("K_TrailCores extension", PerfCounters::treeTraversal);
+
+    ofstream foutForward, foutBackward; 
+    if (KN != NULL)
+        foutForward.open(KN->fileForwardExtension.c_str()); 
+    if (NK != NULL)
+        foutBackward.open(NK->fileBackwardExtension.c_str()); 
+    ExtensionCache forwardCache, backwardCache; 
+    vector<ForwardExtension> forwardExtensions; 
+    vector<BackwardExtension> backwardExtensions; 
+
+    unsigned int maxCost = max(0, T1 - (T1 % 2)); 
+    traverse_K_TrailCoresTree(getSharedCostFunction(maxCost), maxCost, 
+                              [&](const TrailCore& trail) {
+                                  if (KN != NULL)
+                                      KN->forwardExtend(trail, KN->cachedExtensions ? &forwardCache : NULL, 
+                                                        forwardExtensions, foutForward); 
+                                  if (NK != NULL)
+                                      NK->backwardExtend(trail, NK->cachedExtensions ? &backwardCache : NULL, 
+                                                         backwardExtensions, foutBackward); 
+                              }); 
+    time(&ending);
+    double time = difftime(ending, start);
+    SearchStep reportStep("report", PerfCounters::output);
+    if (KN != NULL) {
+        foutForward.close(); 
+        produceHumanReadableFile(KN->fileForwardExtension, true, time);
+    }
+    if (NK != NULL) {
+        foutBackward.close(); 
+        produceHumanReadableFile(NK->fileBackwardExtension, true, time);
+    }
 }
 
-NN_TrailCores::NN_TrailCores(int T3): T3(T3)
+void Shared_K_TrailCores::extendInPipeline(KN_TrailCores* KN, NK_TrailCores* NK, 
+                                           unsigned int nrWorkers, bool saveFile)
+{
+    if ((KN != NULL && KN->T1 != T1) || (NK != NULL && NK->T1 != T1))
+        throw Exception("Shared_K_TrailCores::extendInPipeline: the trail cores are generated for another T1."); 
+    if (nrWorkers == 0)
+        nrWorkers = max(1u, thread::hardware_concurrency()); 
+    time_t start, ending; 
+    time(&start);
+    SearchPhase searchPhase("K_TrailCores pipeline", PerfCounters::treeTraversal);
+
+    ofstream foutForward, foutBackward, fout_K_TrailCores; 
+    if (KN != NULL)
+        foutForward.open(KN->fileForwardExtension.c_str()); 
+    if (NK != NULL)
+        foutBackward.open(NK->fileBackwardExtension.c_str()); 
+    if (saveFile)
+        fout_K_TrailCores.open(file_K_TrailCores.c_str()); 
+    // the workers write the extensions of a batch at once, protected by outputLock
+    mutex outputLock; 
+    TrailCoreQueue queue; 
+
+    vector<thread> workers; 
+    // If the producer throws, the queue is closed and the workers joined 
+    // before the exception is passed on: otherwise the workers would wait
+    // in pop() forever and destroying joinable threads would terminate. 
+    try {
+        for (unsigned int i = 0; i < nrWorkers; i++) {
+            workers.push_back(thread([&]() {
+                ExtensionCache forwardCache, backwardCache; 
+                vector<ForwardExtension> forwardExtensions; 
+                vector<BackwardExtension> backwardExtensions; 
+                TrailCoreQueue::Batch batch; 
+                while (queue.pop(batch)) {
+                    stringstream forwardOut, backwardOut; 
+                    try {
+                        TrailCoreQueue::Batch::const_iterator trail; 
+                        for (trail = batch.begin(); trail != batch.end(); ++trail) {
+                            if (KN != NULL)
+                                KN->forwardExtend(*trail, KN->cachedExtensions ? &forwardCache : NULL, 
+                                                  forwardExtensions, forwardOut); 
+                            if (NK != NULL)
+                                NK->backwardExtend(*trail, NK->cachedExtensions ? &backwardCache : NULL, 
+                                                   backwardExtensions, backwardOut); 
+                        }
+                    } catch (Exception e) {
+                        cout << e.reason << endl; 
+                    }
+                    lock_guard<mutex> guard(outputLock); 
+                    if (KN != NULL)
+                        foutForward << forwardOut.str(); 
+                    if (NK != NULL)
+                        foutBackward << backwardOut.str(); 
+                }
+            })); 
+        }
+
+        unsigned int maxCost = max(0, T1 - (T1 % 2)); 
+        traverse_K_TrailCoresTree(getSharedCostFunction(maxCost), maxCost, 
+                                  [&](const TrailCore& trail) {
+                                      if (saveFile)
+                                          trail.save(fout_K_TrailCores); 
+                                      queue.push(trail); 
+                                  }); 
+    }
+    catch (...) {
+        queue.close(); 
+        for (unsigned int i = 0; i < workers.size(); i++)
+            workers[i].join(); 
+        throw; 
+    }
+    queue.close(); 
+    for (unsigned int i = 0; i < nrWorkers; i++)
+        workers[i].join(); 
+
+    time(&ending);
+    double time = difftime(ending, start);
+    SearchStep reportStep("report", PerfCounters::output);
+    if (saveFile) {
+        fout_K_TrailCores.close(); 
+        produceHumanReadableFileTwoRoundTrailCores(file_K_TrailCores, 1, 1, true, time);
+    }
+    if (KN != NULL) {
+        foutForward.close(); 
+        produceHumanReadableFile(KN->fileForwardExtension, true, time);
+    }
+    if (NK != NULL) {
+        foutBackward.close(); 
+        produceHumanReadableFile(NK->fileBackwardExtension, true, time);
+    }
+}
+
+/** It saves in @a fileName the number of 2-round trail cores per cost. */
+static void saveCountPerCost(const string& fileName, UINT64 totalCount, 
+                             const vector<UINT64>& countPerCost)
+{
+    ofstream fout(fileName.c_str());
+    UINT64 minCost = 0;
+    while ((minCost < countPerCost.size()) && (countPerCost[minCost] == 0))
+        minCost++;
+
+    fout << dec << totalCount << " trails of length 2." << endl;
+    
+    fout << "Minimum cost: " << dec << minCost << endl;
+    for (unsigned int i = minCost; i < countPerCost.size(); i++) {
+        if (countPerCost[i] > 0) {
+            fout.width(8); fout.fill(' ');
+            fout << dec << countPerCost[i] << " trails of cost ";
+            fout.width(2); fout.fill(' ');
+            fout << i << endl ;
+        }
+    }
+    fout << endl;
+    fout.close();
+}
+
+NN_TrailCores::NN_TrailCores(int T3): T3(T3), T3Old(0)
 {
     stringstream stream_N_ForForwardExtension; 
     stream_N_ForForwardExtension << "N-trailCores-T3-";
@@ -401,6 +879,22 @@ NN_TrailCores::NN_TrailCores(int T3): T3(T3)
 
 }
 
+void NN_TrailCores::searchFrom(int aT3Old)
+{
+    if (!(aT3Old < T3))
+        throw Exception("The previous bound must be lower than T3."); 
+    T3Old = aT3Old; 
+
+    stringstream streamForwardExtension;
+    streamForwardExtension << "NN-trailCores-fromForwardExtension-T3-";
+    streamForwardExtension << T3Old << "-" << T3;
+    fileForwardExtension = streamForwardExtension.str();
+
+    stringstream streamBackwardExtension;
+    streamBackwardExtension << "NN-trailCores-fromBackwardExtension-T3-";
+    streamBackwardExtension << T3Old << "-" << T3;
+    fileBackwardExtension = streamBackwardExtension.str(); 
+}
 
 void NN_TrailCores::NN_FromForwardExtension()
 {
@@ -408,6 +902,7 @@ void NN_TrailCores::NN_FromForwardExtension()
     ofstream fout; 
     time_t start, ending; 
     time(&start);
+    SearchPhase searchPhase("NN_FromForwardExtension", PerfCounters::treeTraversal);
 
     unsigned int cpt = 0; 
     unsigned int alpha = 2; 
@@ -418,7 +913,6 @@ void NN_TrailCores::NN_FromForwardExtension()
 
     // To count the number of 2-round |N|-trail cores (A, B) of cost 2 wMinRev(A) + wMinDir(B) below maxCost
     UINT64 totalCount_N = 0; 
-    UINT64 minCost_N;  
     vector<UINT64> countPerCost_N;
 
 
@@ -429,12 +923,17 @@ void NN_TrailCores::NN_FromForwardExtension()
     TwoRoundTrailCoreCostBoundFunction costFBareState(alpha, beta); 
     ColumnsSet colSet;
     BareStateCache bareStateCache;
-    BareStateIterator bareStates(colSet, bareStateCache, costFBareState, maxCost, true);
+    TRAVERSAL_STATISTICS_ONLY(TraversalStatistics tritsStatistics;)
+    BareStateIterator bareStates(colSet, bareStateCache, costFBareState, maxCost, false);
+    progress.setNrFirstLevelUnits(bareStates.countFirstLevelUnits());
+    ++bareStates;
     
 
     fout.open(fileForwardExtension.c_str());
     for (; !bareStates.isEnd(); ++bareStates) {
-        BareState bareState = *bareStates;
+        progress.addNodes();
+        progress.setPrefix(bareStates.nrFirstLevelNodes);
+        const BareState& bareState = *bareStates;
         if (bareState.valid) {
 
             MixedTrailCoreCache mixedCache(bareState);
@@ -443,14 +942,20 @@ void NN_TrailCores::NN_FromForwardExtension()
             N_TrailCore_Iterator iteratorTrits(activeTritsSet, mixedCache,
                                                costFTrits, maxCost, false);  
             for (; !iteratorTrits.isEnd(); ++iteratorTrits) {
-                TwoRoundTrailCore trailCores = *iteratorTrits;   
+                const TwoRoundTrailCore& trailCores = *iteratorTrits;   
+                progress.addNodes();
+                TraceSpan trailSpan("trail core", TraceSpan::sampling);
                 // don't save the trail core
                 cpt++; 
                 if (cpt % 10000 == 0 )
                     cout << cpt << "-th trail to extend " << endl;
                 
-                for (trailCores.statesB.first(); !trailCores.statesB.isEnd(); ++trailCores.statesB) {
-                    stateB = *trailCores.statesB; 
+                SearchStep expansionStep("pattern expansion", PerfCounters::stateExpansion);
+                TroikaStateIterator statesB = trailCores.getStatesB(); 
+                // the states B share their active trytes: the preparation is rebound
+                ForwardExtensionPreparation prep; 
+                for (; !statesB.isEnd(); ++statesB) {
+                    stateB = *statesB; 
                     stateA.setInvL(stateB); 
                     TrailCore trail(stateA, stateB, trailCores.wA, trailCores.wB); 
                  
@@ -463,43 +968,36 @@ void NN_TrailCores::NN_FromForwardExtension()
                     totalCount_N++; 
 
                     // forward extension
-                    long double maxWeightExtension = T3 - (long double)trail.wMinRev; 
-                    ForwardExtensionPreparation prep(stateB, maxWeightExtension);
+                    WeightBound maxWeightExtension = WeightBound(T3) - trail.wMinRev; 
+                    SearchStep preparationStep("preparation", PerfCounters::forwardExtension);
+                    prep.set(stateB, maxWeightExtension);
+                    prep.minWeightExtension = WeightBound(T3Old) - trail.wMinRev; 
+                    preparationStep.stop();
+                    SearchStep extensionsStep("extensions", PerfCounters::forwardExtension);
                     ForwardExtensionIterator extensions(prep, stateB);
                     for (; !extensions.isEnd(); ++extensions) {
-                        ForwardExtension extension = *extensions;
+                        const ForwardExtension& extension = *extensions;
                         if (!extension.stateD.isInKernel()) {   
                             TrailCore extendedTrail(trail, extension);
                             extendedTrail.save(fout);             
+                            progress.addTrail(extendedTrail.weight);
                         }
                     }                     
                 }  
             }
+            TRAVERSAL_STATISTICS_ONLY(tritsStatistics += iteratorTrits.statistics;)
         }
     }
     time(&ending);
+    TRAVERSAL_STATISTICS_ONLY(saveTraversalStatistics(fileForwardExtension + "-statistics.json", 
+                                                      {{"BareStateIterator", bareStates.statistics}, 
+                                                       {"N_TrailCore_Iterator", tritsStatistics}});)
     double time = difftime(ending, start);
+    SearchStep reportStep("report", PerfCounters::output);
     fout.close();
     produceHumanReadableFile(fileForwardExtension, true, time);
 
-    fout.open(file_N_ForForwardExtension_count);
-    minCost_N = 0;
-    while ((minCost_N < countPerCost_N.size()) && (countPerCost_N[minCost_N] == 0))
-        minCost_N++;
-
-    fout << dec << totalCount_N << " trails of length 2." << endl;
-    
-    fout << "Minimum cost: " << dec << minCost_N << endl;
-    for (unsigned int i = minCost_N; i < countPerCost_N.size(); i++) {
-        if (countPerCost_N[i] > 0) {
-            fout.width(8); fout.fill(' ');
-            fout << dec << countPerCost_N[i] << " trails of cost ";
-            fout.width(2); fout.fill(' ');
-            fout << i << endl ;
-        }
-    }
-    fout << endl;
-    fout.close();
+    saveCountPerCost(file_N_ForForwardExtension_count, totalCount_N, countPerCost_N);
 
 }
 
@@ -509,6 +1007,7 @@ void NN_TrailCores::NN_FromBackwardExtension()
     ofstream fout; 
     time_t start, ending; 
     time(&start);
+    SearchPhase searchPhase("NN_FromBackwardExtension", PerfCounters::treeTraversal);
 
     unsigned int alpha = 1; 
     unsigned int beta = 2;
@@ -519,7 +1018,6 @@ void NN_TrailCores::NN_FromBackwardExtension()
 
     // To count the number of 2-round |N|-trail cores (A, B) of cost wMinRev(A) + 2 wMinDir(B) below maxCost
     UINT64 totalCount_N = 0; 
-    UINT64 minCost_N;  
     vector<UINT64> countPerCost_N;
 
     TroikaState stateB; 
@@ -529,11 +1027,16 @@ void NN_TrailCores::NN_FromBackwardExtension()
     TwoRoundTrailCoreCostBoundFunction costFBareState(alpha, beta); 
     ColumnsSet colSet;
     BareStateCache bareStateCache;
-    BareStateIterator bareStates(colSet, bareStateCache, costFBareState, maxCost, true);
+    TRAVERSAL_STATISTICS_ONLY(TraversalStatistics tritsStatistics;)
+    BareStateIterator bareStates(colSet, bareStateCache, costFBareState, maxCost, false);
+    progress.setNrFirstLevelUnits(bareStates.countFirstLevelUnits());
+    ++bareStates;
     
     fout.open(fileBackwardExtension.c_str());
     for (; !bareStates.isEnd(); ++bareStates) {
-        BareState bareState = *bareStates;
+        progress.addNodes();
+        progress.setPrefix(bareStates.nrFirstLevelNodes);
+        const BareState& bareState = *bareStates;
         if (bareState.valid) {
 
             MixedTrailCoreCache mixedCache(bareState);
@@ -542,14 +1045,20 @@ void NN_TrailCores::NN_FromBackwardExtension()
             N_TrailCore_Iterator iteratorTrits(activeTritsSet, mixedCache,
                                                costFTrits, maxCost, false);  
             for (; !iteratorTrits.isEnd(); ++iteratorTrits) {
-                TwoRoundTrailCore trailCores = *iteratorTrits;   
+                const TwoRoundTrailCore& trailCores = *iteratorTrits;   
+                progress.addNodes();
+                TraceSpan trailSpan("trail core", TraceSpan::sampling);
                 // don't save the trail
                 cpt++; 
                 if (cpt % 10000 == 0 )
                     cout << cpt << "-th trail to extend " << endl;
                 
-                for (trailCores.statesB.first(); !trailCores.statesB.isEnd(); ++trailCores.statesB) {
-                    stateB = *trailCores.statesB; 
+                SearchStep expansionStep("pattern expansion", PerfCounters::stateExpansion);
+                TroikaStateIterator statesB = trailCores.getStatesB(); 
+                // the preparation is rebound when consecutive states A share their active trytes
+                BackwardExtensionPreparation prep; 
+                for (; !statesB.isEnd(); ++statesB) {
+                    stateB = *statesB; 
                     stateA.setInvL(stateB); 
                     TrailCore trail(stateA, stateB, trailCores.wA, trailCores.wB); 
                     // regarder s'il y un probleme et compter les trail 
@@ -563,60 +1072,191 @@ void NN_TrailCores::NN_FromBackwardExtension()
                     totalCount_N++; 
 
                     // etendre vers la droite
-                    long double maxWeightExtension = T3 - (long double)trail.wMinDir; 
-                    BackwardExtensionPreparation prep(stateA, maxWeightExtension);
+                    WeightBound maxWeightExtension = WeightBound(T3) - trail.wMinDir; 
+                    SearchStep preparationStep("preparation", PerfCounters::backwardExtension);
+                    prep.set(stateA, maxWeightExtension);
+                    prep.minWeightExtension = WeightBound(T3Old) - trail.wMinDir; 
+                    preparationStep.stop();
+                    SearchStep extensionsStep("extensions", PerfCounters::backwardExtension);
                     BackwardExtensionIterator extensions(prep, stateA);
                     for (; !extensions.isEnd(); ++extensions) {
-                        BackwardExtension extension = *extensions;
+                        const BackwardExtension& extension = *extensions;
                         if (!extension.stateB.isInKernel()) {   
                             TrailCore extendedTrail(trail, extension);
                             extendedTrail.save(fout);             
+                            progress.addTrail(extendedTrail.weight);
                         }
                     }                     
                 }  
             }
+            TRAVERSAL_STATISTICS_ONLY(tritsStatistics += iteratorTrits.statistics;)
         }
     }
     time(&ending);
+    TRAVERSAL_STATISTICS_ONLY(saveTraversalStatistics(fileBackwardExtension + "-statistics.json", 
+                                                      {{"BareStateIterator", bareStates.statistics}, 
+                                                       {"N_TrailCore_Iterator", tritsStatistics}});)
     double time = difftime(ending, start);
+    SearchStep reportStep("report", PerfCounters::output);
     fout.close();
     produceHumanReadableFile(fileBackwardExtension, true, time);
 
-    fout.open(file_N_ForBackwardExtension_count);
-    minCost_N = 0;
-    while ((minCost_N < countPerCost_N.size()) && (countPerCost_N[minCost_N] == 0))
-        minCost_N++;
+    saveCountPerCost(file_N_ForBackwardExtension_count, totalCount_N, countPerCost_N);
+}
+ 
+void NN_TrailCores::NN_FromForwardAndBackwardExtension()
+{
+    ofstream foutForward, foutBackward; 
+    time_t start, ending; 
+    time(&start);
+    SearchPhase searchPhase("NN_FromForwardAndBackwardExtension", PerfCounters::treeTraversal);
 
-    fout << dec << totalCount_N << " trails of length 2." << endl;
-    
-    fout << "Minimum cost: " << dec << minCost_N << endl;
-    for (unsigned int i = minCost_N; i < countPerCost_N.size(); i++) {
-        if (countPerCost_N[i] > 0) {
-            fout.width(8); fout.fill(' ');
-            fout << dec << countPerCost_N[i] << " trails of cost ";
-            fout.width(2); fout.fill(' ');
-            fout << i << endl ;
+    // The cost regions of NN_FromForwardExtension and NN_FromBackwardExtension
+    unsigned int maxCostForward = T3; 
+    if (maxCostForward % 2 == 1) // The cost is always even
+        maxCostForward--;
+    unsigned int maxCostBackward = T3 - 1; 
+    if (maxCostBackward % 2 == 1)
+        maxCostBackward--;
+
+    unsigned int cpt = 0; 
+    UINT64 totalCountForward = 0; 
+    UINT64 totalCountBackward = 0; 
+    vector<UINT64> countPerCostForward;
+    vector<UINT64> countPerCostBackward;
+
+    TroikaState stateB; 
+    TroikaState stateA; 
+
+    Sbox sbox;
+    TwoRoundTrailCoreCostBoundFunction costFBareState(2, 1, maxCostForward, 1, 2, maxCostBackward); 
+    ColumnsSet colSet;
+    BareStateCache bareStateCache;
+    TRAVERSAL_STATISTICS_ONLY(TraversalStatistics tritsStatistics;)
+    BareStateIterator bareStates(colSet, bareStateCache, costFBareState, maxCostForward, false);
+    progress.setNrFirstLevelUnits(bareStates.countFirstLevelUnits());
+    ++bareStates;
+
+    foutForward.open(fileForwardExtension.c_str());
+    foutBackward.open(fileBackwardExtension.c_str());
+    for (; !bareStates.isEnd(); ++bareStates) {
+        progress.addNodes();
+        progress.setPrefix(bareStates.nrFirstLevelNodes);
+        const BareState& bareState = *bareStates;
+        if (bareState.valid) {
+
+            MixedTrailCoreCache mixedCache(bareState);
+            ActiveTritsSet activeTritsSet(bareState.firstActiveTritsAllowed); 
+            TwoRoundTrailCoreCostFunction costFTrits(2, 1, maxCostForward, 1, 2, maxCostBackward);
+            N_TrailCore_Iterator iteratorTrits(activeTritsSet, mixedCache,
+                                               costFTrits, maxCostForward, false);  
+            for (; !iteratorTrits.isEnd(); ++iteratorTrits) {
+                const TwoRoundTrailCore& trailCores = *iteratorTrits;   
+                progress.addNodes();
+                TraceSpan trailSpan("trail core", TraceSpan::sampling);
+                cpt++; 
+                if (cpt % 10000 == 0 )
+                    cout << cpt << "-th trail to extend " << endl;
+
+                // route the trail core to the extensions whose cost region contains it
+                bool extendForward = (2 * trailCores.wA + trailCores.wB <= maxCostForward); 
+                bool extendBackward = (trailCores.wA + 2 * trailCores.wB <= maxCostBackward); 
+                
+                SearchStep expansionStep("pattern expansion", PerfCounters::stateExpansion);
+                TroikaStateIterator statesB = trailCores.getStatesB(); 
+                ForwardExtensionPreparation forwardPrep; 
+                BackwardExtensionPreparation backwardPrep; 
+                for (; !statesB.isEnd(); ++statesB) {
+                    stateB = *statesB; 
+                    stateA.setInvL(stateB); 
+                    TrailCore trail(stateA, stateB, trailCores.wA, trailCores.wB); 
+
+                    if (extendForward) {
+                        unsigned int cost = 2 * (long double)trail.wMinRev + (long double)trail.wMinDir; 
+                        if (cost >= countPerCostForward.size())
+                            countPerCostForward.resize(cost + 1, 0);
+                        countPerCostForward[cost]++; 
+                        totalCountForward++; 
+
+                        WeightBound maxWeightExtension = WeightBound(T3) - trail.wMinRev; 
+                        SearchStep preparationStep("preparation", PerfCounters::forwardExtension);
+                        forwardPrep.set(stateB, maxWeightExtension);
+                        forwardPrep.minWeightExtension = WeightBound(T3Old) - trail.wMinRev; 
+                        preparationStep.stop();
+                        SearchStep extensionsStep("extensions", PerfCounters::forwardExtension);
+                        ForwardExtensionIterator extensions(forwardPrep, stateB);
+                        for (; !extensions.isEnd(); ++extensions) {
+                            const ForwardExtension& extension = *extensions;
+                            if (!extension.stateD.isInKernel()) {   
+                                TrailCore extendedTrail(trail, extension);
+                                extendedTrail.save(foutForward);             
+                                progress.addTrail(extendedTrail.weight);
+                            }
+                        }
+                    }
+                    if (extendBackward) {
+                        trail.checkTrailCore(sbox);
+                        unsigned int cost = (long double)trail.wMinRev + 2 * (long double)trail.wMinDir; 
+                        if (cost >= countPerCostBackward.size())
+                            countPerCostBackward.resize(cost + 1, 0);
+                        countPerCostBackward[cost]++; 
+                        totalCountBackward++; 
+
+                        WeightBound maxWeightExtension = WeightBound(T3) - trail.wMinDir; 
+                        SearchStep preparationStep("preparation", PerfCounters::backwardExtension);
+                        backwardPrep.set(stateA, maxWeightExtension);
+                        backwardPrep.minWeightExtension = WeightBound(T3Old) - trail.wMinDir; 
+                        preparationStep.stop();
+                        SearchStep extensionsStep("extensions", PerfCounters::backwardExtension);
+                        BackwardExtensionIterator extensions(backwardPrep, stateA);
+                        for (; !extensions.isEnd(); ++extensions) {
+                            const BackwardExtension& extension = *extensions;
+                            if (!extension.stateB.isInKernel()) {   
+                                TrailCore extendedTrail(trail, extension);
+                                extendedTrail.save(foutBackward);             
+                                progress.addTrail(extendedTrail.weight);
+                            }
+                        }
+                    }
+                }  
+            }
+            TRAVERSAL_STATISTICS_ONLY(tritsStatistics += iteratorTrits.statistics;)
         }
     }
-    fout << endl;
-    fout.close();
+    time(&ending);
+    TRAVERSAL_STATISTICS_ONLY(saveTraversalStatistics("NN-trailCores-fromForwardAndBackwardExtension-T3-"
+                                                      + to_string(T3) + "-statistics.json", 
+                                                      {{"BareStateIterator", bareStates.statistics}, 
+                                                       {"N_TrailCore_Iterator", tritsStatistics}});)
+    double time = difftime(ending, start);
+    SearchStep reportStep("report", PerfCounters::output);
+    foutForward.close();
+    foutBackward.close();
+    produceHumanReadableFile(fileForwardExtension, true, time);
+    produceHumanReadableFile(fileBackwardExtension, true, time);
+
+    saveCountPerCost(file_N_ForForwardExtension_count, totalCountForward, countPerCostForward);
+    saveCountPerCost(file_N_ForBackwardExtension_count, totalCountBackward, countPerCostBackward);
 }
  
 void NN_TrailCores::nrTrailsFound() 
 {
-    stringstream fileIn, fileOut; 
+    stringstream fileOut; 
     
-    fileOut << "NN-" << T3; 
+    fileOut << "NN-"; 
+    if (T3Old > 0)
+        fileOut << T3Old << "-"; 
+    fileOut << T3; 
     ofstream fout(fileOut.str());
 
-    fileIn << "NN-trailCores-fromForwardExtension-T3-" << T3;
-    TrailFileIterator trails(fileIn.str()); 
+    TrailFileIterator trails(fileForwardExtension); 
     for (; ! trails.isEnd(); ++trails)
         (*trails).save(fout);
-    fileIn.clear(); fileIn.str(""); fileIn << "NN-trailCores-fromBackwardExtension-T3-" << T3; 
-    TrailFileIterator trails_(fileIn.str()); 
+    TrailFileIterator trails_(fileBackwardExtension); 
     for (; ! trails_.isEnd(); ++trails_)
         (*trails_).save(fout);
     fout.close();
     checkTrailAndParity(fileOut.str(), vector<Parity> {N, N});
+    if (T3Old > 0)
+        mergeWithPreviousCatalog("NN", T3Old, T3); 
 }
@@ -23,21 +23,56 @@ parity profile |K|N|, |N|K| or |N|N| up to some weight.
 #include "forwardExtension.h"
 #include "backwardExtension.h"
 #include "backwardInKernelExtension.h"
+#include "extensionCache.h"
+
+class Shared_K_TrailCores; 
 
 class KN_TrailCores
 {
     private:
         int T3; 
         int T1;
+        /** The bound of the previous run of an incremental search, 0 otherwise. */ 
+        int T3Old; 
+        /** True if the forward extensions are taken from an ExtensionCache. */ 
+        bool cachedExtensions; 
         string fileInKernelExtension; 
         string fileForwardExtension;
         string file_K_TrailCores; 
     public:
         KN_TrailCores(int T3, int T1);
+        /** It makes the searches below incremental from a previous run with
+          * the same T1 up to @a aT3Old < T3: the extensions only output the 
+          * trail cores of weight in (T3Old, T3], in files named with both 
+          * bounds, and nrTrailsFound() merges them into the sorted catalog
+          * KN-<T3Old>-verif of the previous run to give KN-<T3>-verif. The 
+          * file of K_TrailCores() only depends on T1 and is read again. 
+          */ 
+        void searchFrom(int aT3Old); 
         void K_TrailCores(); 
+        /** It makes KN_FromForwardExtension read the file of @a shared instead
+          * of the file written by K_TrailCores. The trail cores with 
+          * wMinRev(A) above T1 are skipped. 
+          */ 
+        void useShared_K_TrailCores(const Shared_K_TrailCores& shared); 
+        /** It makes the forward extensions outside the kernel be taken from 
+          * an ExtensionCache per thread (see extensionCache.h) instead of 
+          * being enumerated for each trail core. It only pays off when many
+          * trail cores share their state B up to a translation. 
+          */ 
+        void useExtensionCache(bool enabled = true) { cachedExtensions = enabled; }
         void KN_FromInKernelExtension();
         void KN_FromForwardExtension();
         void nrTrailsFound();
+    private:
+        /** It saves in @a fout the forward extensions of @a trailToExtend 
+          * with D outside the kernel, if wMinRev(A) is at most T1. They are 
+          * taken from @a cache through @a extensions if @a cache is not NULL,
+          * and streamed from a ForwardExtensionIterator otherwise. 
+          */ 
+        void forwardExtend(const TrailCore& trailToExtend, ExtensionCache* cache, 
+                           vector<ForwardExtension>& extensions, ostream& fout); 
+        friend class Shared_K_TrailCores; 
 };
 
 class NK_TrailCores
@@ -45,29 +80,100 @@ class NK_TrailCores
     private:
         int T3; 
         int T1; 
+        /** The bound of the previous run of an incremental search, 0 otherwise. */ 
+        int T3Old; 
+        /** True if the backward extensions are taken from an ExtensionCache. */ 
+        bool cachedExtensions; 
         string fileInKernelExtension; 
         string fileBackwardExtension;
         string file_K_TrailCores; 
     public:
         NK_TrailCores(int T3, int T1);
+        /** It makes the searches below incremental from a previous run, as 
+          * KN_TrailCores::searchFrom(), with the catalog NK-<T3Old>-verif. 
+          */ 
+        void searchFrom(int aT3Old); 
         void K_TrailCores(); 
+        /** It makes NK_FromBackwardExtension read the file of @a shared instead
+          * of the file written by K_TrailCores. The trail cores with 
+          * wMinDir(B) above T1 are skipped. 
+          */ 
+        void useShared_K_TrailCores(const Shared_K_TrailCores& shared); 
+        /** It makes the backward extensions outside the kernel be taken from 
+          * an ExtensionCache, as KN_TrailCores::useExtensionCache(). 
+          */ 
+        void useExtensionCache(bool enabled = true) { cachedExtensions = enabled; }
         void NK_FromInKernelExtension();
         void NK_FromBackwardExtension();
         void nrTrailsFound();
+    private:
+        /** It saves in @a fout the backward extensions of @a trailToExtend 
+          * with A outside the kernel, if wMinDir(B) is at most T1. They are 
+          * taken from @a cache through @a extensions if @a cache is not NULL,
+          * and streamed from a BackwardExtensionIterator otherwise. 
+          */ 
+        void backwardExtend(const TrailCore& trailToExtend, ExtensionCache* cache, 
+                            vector<BackwardExtension>& extensions, ostream& fout); 
+        friend class Shared_K_TrailCores; 
+};
+
+/** The 2-round in-kernel trail cores (A, B) needed by both KN_TrailCores and
+  * NK_TrailCores with the same T1, ie with wMinRev(A) or wMinDir(B) at most 
+  * T1. They are enumerated in a single traversal, and either saved in a 
+  * file read by both, or directly extended without intermediate file. 
+  */ 
+class Shared_K_TrailCores
+{
+    private:
+        int T1; 
+        string file_K_TrailCores; 
+    public:
+        Shared_K_TrailCores(int T1);
+        /** It saves the trail cores in the file K-trailCores-T1-<T1>. */ 
+        void K_TrailCores(); 
+        /** It extends the trail cores as they are enumerated: forward as in 
+          * KN_FromForwardExtension if @a KN is not NULL, and backward as in 
+          * NK_FromBackwardExtension if @a NK is not NULL. 
+          */ 
+        void extend(KN_TrailCores* KN, NK_TrailCores* NK); 
+        /** It is like extend(), but the trail cores are enumerated by the 
+          * calling thread and passed through a bounded TrailCoreQueue to 
+          * @a nrWorkers threads (0 for one per hardware thread) that extend
+          * them, so that the generation and the extensions overlap. The 
+          * extended trail cores are written in the order the batches are 
+          * extended. If @a saveFile is true, the trail cores are also saved
+          * in the file K-trailCores-T1-<T1>. 
+          */ 
+        void extendInPipeline(KN_TrailCores* KN, NK_TrailCores* NK, 
+                              unsigned int nrWorkers = 0, bool saveFile = false); 
+        const string& getFileName() const { return file_K_TrailCores; }
 };
 
 class NN_TrailCores
 {
     private:
         int T3;
+        /** The bound of the previous run of an incremental search, 0 otherwise. */ 
+        int T3Old; 
         string file_N_ForForwardExtension_count; 
         string file_N_ForBackwardExtension_count;
         string fileForwardExtension; 
         string fileBackwardExtension;  
     public:
         NN_TrailCores(int T3);
+        /** It makes the searches below incremental from a previous run, as 
+          * KN_TrailCores::searchFrom(), with the catalog NN-<T3Old>-verif. 
+          * The 2-round trail cores are counted as in a full run. 
+          */ 
+        void searchFrom(int aT3Old); 
         void NN_FromForwardExtension(); 
         void NN_FromBackwardExtension(); 
+        /** It produces the outputs of NN_FromForwardExtension and 
+          * NN_FromBackwardExtension with a single traversal of the 2-round
+          * trail cores of the union of their cost regions. Each trail core
+          * is extended forward, backward or both, according to its costs.
+          */ 
+        void NN_FromForwardAndBackwardExtension(); 
         void nrTrailsFound();
 };
 
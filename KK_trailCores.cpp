@@ -1,7 +1,10 @@
 /* KK_trailCores.cpp */ 
 #include "KK_trailCores.h"
 #include "backwardInKernelExtension.h"
+#include "progressReporter.h"
+#include "searchPhase.h"
 #include "state.h"
+#include "trace.h"
 #include "trailCore.h"
 #include "traversal.h"
 #include "troikaStateIterator.h"
@@ -262,7 +265,7 @@ enum Type ActiveTritsAtCAndDSet::getFirstChildType(
 
 ActiveStatesCAndDCache::ActiveStatesCAndDCache()
 : lowestNrActiveTrytesA(0), nrActiveTrytesC(0), nrActiveTrytesD(0),
-  dummy(true), valid(false), newValidPattern(false)
+  dummy(true), valid(false), newValidPattern(false), uniquePatterns(true)
 {
     for (int x = 0; x < COLUMNS; x++) {
         for (unsigned int y = 0; y < ROWS; y++) {
@@ -331,9 +334,13 @@ void ActiveStatesCAndDCache::push(const ActiveTritAtCAndD& trit)
     valid = false;
     newValidPattern = false; 
     if (isAValidPattern(trit)) {
+        valid = true; 
+        if (!uniquePatterns) {
+            newValidPattern = true; 
+            return; 
+        }
         ActiveState biggestRepresentative; 
         stateC.setTheBiggestRepresentative(biggestRepresentative);
-        valid = true; 
         if (patternsC.find(biggestRepresentative) == patternsC.end()) {
             patternsC.insert(biggestRepresentative);
             newValidPattern = true; 
@@ -419,56 +426,190 @@ unsigned int KK_TrailCoreCostFunction::getCost(
                + cache.nrActiveTrytesC
                + cache.nrActiveTrytesD);
 }
+
+/** It returns the maximum weight of a transition through the S-box. */ 
+static Weight getMaxTryteWeight()
+{
+    Sbox sbox; 
+    Weight maxWeight; 
+    for (unsigned int input = 1; input < 27; input++) {
+        for (unsigned int i = 0; i < Sbox::outputDiff[input].size(); i++) {
+            if (maxWeight < Sbox::outputDiff[input][i].weight)
+                maxWeight = Sbox::outputDiff[input][i].weight; 
+        }
+    }
+    return maxWeight; 
+}
+
+Weight KK_TrailCoreCostFunction::getMaxWeight(const ActiveStatesCAndDCache& cache) const
+{
+    static const Weight maxTryteWeight = getMaxTryteWeight(); 
+    ActiveState trytesA; 
+    TritPosition pA; 
+    for (unsigned int xTryte = 0; xTryte < 3; xTryte++) {
+        for (unsigned int y = 0; y < ROWS; y++) {
+            for (unsigned int z = 0; z < SLICES; z++) {
+                if (cache.stateC.isTryteActive(xTryte, y, z)) {
+                    TrytePosition tryteC(xTryte, y, z); 
+                    for (unsigned int tritIndex = 0; tritIndex < 3; tritIndex++) {
+                        pA.set(tryteC, tritIndex);
+                        pA.invSRSL(); 
+                        trytesA.activateTrit(pA); 
+                    }
+                }
+            }
+        }
+    }
+    return Weight(2 * trytesA.getNrActiveTrytes())
+           + maxTryteWeight * cache.nrActiveTrytesC
+           + Weight(2 * cache.nrActiveTrytesD); 
+}
  
 void ActiveStatesCAndD::set(const vector<ActiveTritAtCAndD>& unitList, 
                             const ActiveStatesCAndDCache& cache, 
                             const KK_TrailCoreCostFunction& costF, 
                             unsigned int aMaxCost)
 {
-   activeD = cache.stateD;
-   activeC = cache.stateC; 
+   activeD = &cache.stateD;
+   activeC = &cache.stateC; 
    wMinDirD = 2 * cache.nrActiveTrytesD; 
    wMinRevC = 2 * cache.nrActiveTrytesC; 
 }
 
-void KK_TrailCores::generate_KK_trailCores()
+void KK_TrailCores::traverse(long double maxWeight, 
+                            const function<void(const TrailCore&)>& output, 
+                            long double minWeight)
 {
-    time_t start, ending;  
-    time(&start); 
-    ofstream fout(file_KK_TrailCores.c_str());
-
     ActiveTritsAtCAndDSet KKSet;
     ActiveStatesCAndDCache KKCache;
     KK_TrailCoreCostFunction KKCostF;
-    ActiveStatesCAndDIterator it(KKSet, KKCache, KKCostF, T3, true);
+    ActiveStatesCAndDIterator it(KKSet, KKCache, KKCostF, maxWeight, false);
+    progress.setNrFirstLevelUnits(it.countFirstLevelUnits());
+    ++it;
 
     TroikaState stateC; 
     TroikaState stateD; 
 
     for (; !it.isEnd(); ++it) {
+        progress.addNodes();
+        progress.setPrefix(it.nrFirstLevelNodes);
       
-        if (it.cache.valid) {
+        if (it.cache.valid && (minWeight == 0 
+                               || it.cost.back() > minWeight
+                               || KKCostF.getMaxWeight(it.cache) > WeightBound(minWeight))) {
         
-            ActiveStatesCAndD current = *it; 
-            TroikaStateIterator statesD(current.activeD);
-            long double maxWeightExtension = T3 - current.wMinDirD; 
-            BackwardInKernelExtensionPreparation prep(maxWeightExtension, current.activeC);
+            const ActiveStatesCAndD& current = *it; 
+            TraceSpan nodeSpan("KK node", TraceSpan::sampling);
+            WeightBound maxWeightExtension = WeightBound(maxWeight) - Weight(current.wMinDirD); 
+            SearchStep preparationStep("preparation", PerfCounters::inKernelExtension);
+            BackwardInKernelExtensionPreparation prep(maxWeightExtension, *current.activeC);
+            prep.minWeightExtension = WeightBound(minWeight) - Weight(current.wMinDirD); 
+            preparationStep.stop();
+            SearchStep expansionStep("pattern expansion", PerfCounters::stateExpansion);
+            TroikaStateIterator statesD(*current.activeD);
             
             for (; !statesD.isEnd(); ++statesD) {
                    
                    stateD = *statesD; 
                    stateC.setInvSRSL(stateD);
+                   SearchStep extensionsStep("extensions", PerfCounters::inKernelExtension);
                    BackwardInKernelExtensionIterator extensions(prep, stateC);
                    for (; !extensions.isEnd(); ++extensions) {
-                       BackwardInKernelExtension ext = *extensions;
+                       const BackwardInKernelExtension& ext = *extensions;
                        TrailCore trail (ext.stateA, ext.stateB, stateC, stateD, ext.wMinRevA, ext.wBC, current.wMinDirD);
-                       trail.save(fout); 
+                       output(trail); 
+                       progress.addTrail(trail.weight);
                     }
                }
           }
     }
+    TRAVERSAL_STATISTICS_ONLY(saveTraversalStatistics(file_KK_TrailCores + "-statistics.json", 
+                                                      {{"ActiveStatesCAndDIterator", it.statistics}});)
+}
+
+void KK_TrailCores::generate_KK_trailCores()
+{
+    time_t start, ending;  
+    time(&start); 
+    SearchPhase searchPhase("generate_KK_trailCores", PerfCounters::treeTraversal);
+    ofstream fout(file_KK_TrailCores.c_str());
+
+    traverse(T3, [&fout](const TrailCore& trail) { trail.save(fout); }); 
+    time(&ending);
+    SearchStep reportStep("report", PerfCounters::output);
+    fout.close();
+    double time = difftime(ending, start);
+    produceHumanReadableFile(file_KK_TrailCores, true, time);    
+}
+
+void KK_TrailCores::generate_KK_trailCoresFrom(long double T3Old)
+{
+    if (!(T3Old < T3))
+        throw Exception("The previous bound must be lower than T3."); 
+    stringstream stream_oldFile; 
+    stream_oldFile << "KK-trailCores-T3-" << T3Old; 
+    TrailFileIterator oldTrails(stream_oldFile.str()); 
+
+    time_t start, ending;  
+    time(&start); 
+    SearchPhase searchPhase("generate_KK_trailCoresFrom", PerfCounters::treeTraversal);
+    ofstream fout(file_KK_TrailCores.c_str());
+
+    for (; !oldTrails.isEnd(); ++oldTrails)
+        (*oldTrails).save(fout); 
+    traverse(T3, [&fout](const TrailCore& trail) { trail.save(fout); }, T3Old); 
     time(&ending);
+    SearchStep reportStep("report", PerfCounters::output);
     fout.close();
     double time = difftime(ending, start);
     produceHumanReadableFile(file_KK_TrailCores, true, time);    
 }
+
+void KK_TrailCores::generate_KK_trailCoresInBand(long double T3Min)
+{
+    if (!(T3Min < T3))
+        throw Exception("The lower bound of the band must be lower than T3."); 
+    stringstream stream_bandFile; 
+    stream_bandFile << "KK-trailCores-T3-" << T3Min << "-" << T3; 
+    string file_band = stream_bandFile.str(); 
+
+    time_t start, ending;  
+    time(&start); 
+    SearchPhase searchPhase("generate_KK_trailCoresInBand", PerfCounters::treeTraversal);
+    ofstream fout(file_band.c_str());
+
+    traverse(T3, [&fout](const TrailCore& trail) { trail.save(fout); }, T3Min); 
+    time(&ending);
+    SearchStep reportStep("report", PerfCounters::output);
+    fout.close();
+    double time = difftime(ending, start);
+    produceHumanReadableFile(file_band, true, time);    
+}
+
+void KK_TrailCores::generateLowestWeightTrailCores(unsigned int k, unsigned int step)
+{
+    time_t start, ending;  
+    time(&start); 
+    SearchPhase searchPhase("generateLowestWeightTrailCores", PerfCounters::treeTraversal);
+
+    // The cost of a node is a lower bound on the weight of the trail cores 
+    // of its subtree and is at least 2 * 3 (one active tryte at A, C and D).
+    LowestWeightTrailCores lowest(k); 
+    unsigned int lastBound = searchLowestWeightTrailCores(lowest, 6, T3, step, 
+        [this](unsigned int bound, LowestWeightTrailCores& kept) {
+            traverse(bound, [&kept](const TrailCore& trail) { kept.add(trail); }); 
+            cout << "bound " << bound << ": " << kept.size() << " trail cores kept" << endl; 
+        }); 
+    if (!lowest.isFull())
+        cout << "No other trail core of weight up to " << lastBound << "." << endl; 
+    time(&ending);
+
+    SearchStep reportStep("report", PerfCounters::output);
+    stringstream fileName; 
+    fileName << file_KK_TrailCores << "-lowest-" << k; 
+    ofstream fout(fileName.str().c_str()); 
+    lowest.save(fout); 
+    fout.close(); 
+    double time = difftime(ending, start);
+    produceHumanReadableFile(fileName.str(), true, time);    
+}
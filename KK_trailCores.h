@@ -16,12 +16,14 @@
 */
 
 #include <fstream>
+#include <functional>
 #include <iostream> 
 #include <iterator>
 #include <ostream>
 #include <sstream>
 #include <map>
 #include <set>
+#include "memoryAccounting.h"
 #include "state.h"
 #include "traversal.h"
 #include "sbox.h"
@@ -151,12 +153,14 @@ class ActiveTritsAtCAndDSet
 /** The output representation for the valid activity patterns (C, D). */ 
 class ActiveStatesCAndD {
     public: 
-        ActiveState activeD;
-        ActiveState activeC;
+        /** The activity pattern of D, borrowed from the cache of the iterator. */ 
+        const ActiveState* activeD;
+        /** The activity pattern of C, borrowed from the cache of the iterator. */ 
+        const ActiveState* activeC;
         unsigned int wMinRevC; 
         unsigned int wMinDirD;
     public: 
-        ActiveStatesCAndD(): wMinRevC(0), wMinDirD(0){};
+        ActiveStatesCAndD(): activeD(NULL), activeC(NULL), wMinRevC(0), wMinDirD(0){};
         void set(const vector<ActiveTritAtCAndD>& unitList, 
                  const ActiveStatesCAndDCache& cache, 
                  const KK_TrailCoreCostFunction& costF, 
@@ -177,7 +181,8 @@ class ActiveStatesCAndDCache
           * and D that were found. It is used to avoid saving states for which 
           * a reprensative is already known.
           */
-        set<ActiveState> patternsC; 
+        set<ActiveState, less<ActiveState>, 
+            AccountedAllocator<ActiveState, memoryPatterns>> patternsC; 
         ActiveState stateC; 
         ActiveState stateD;
         /** Variable used to compute a lower bound on the weights of a 
@@ -226,6 +231,12 @@ class ActiveStatesCAndDCache
           * or or not.
           */ 
         bool newValidPattern; 
+        /** If false, the valid patterns are not recorded in patternsC and 
+          * each of them is new. The tree then no longer depends on the 
+          * order of the nodes visited, as required by the random probes of
+          * GenericTreeIterator::estimateSize(). It is true by default. 
+          */ 
+        bool uniquePatterns; 
     public:
         ActiveStatesCAndDCache(); 
         void pushDummy(); 
@@ -253,6 +264,15 @@ class KK_TrailCoreCostFunction {
         KK_TrailCoreCostFunction(){}; 
         unsigned int getCost(const vector<ActiveTritAtCAndD>& unitList,
                              const ActiveStatesCAndDCache& cache) const;
+        /** It returns an upper bound on the weights of the 3-round trail 
+          * cores (A, B, C, D) with the activity patterns of C and D of the 
+          * cache. A can only be active in the trytes that contain the image 
+          * by invSRSL of a trit of an active tryte of C, and each active 
+          * tryte of C weighs at most the maximum weight of the S-box. 
+          * Unlike the cost, it is not an upper bound for the children of 
+          * the node. 
+          */ 
+        Weight getMaxWeight(const ActiveStatesCAndDCache& cache) const;
 }; 
 
 /** This class is used to find all the 3-round trail cores (A, B, C, D)
@@ -267,6 +287,36 @@ class KK_TrailCores {
     public: 
         KK_TrailCores(long double T3); 
         void generate_KK_trailCores();
+        /** It generates the same file as generate_KK_trailCores() from the 
+          * file of a previous run with a lower bound @a T3Old: the trail 
+          * cores of that file are copied and only the trail cores of weight 
+          * in (T3Old, T3] are generated. The patterns of C and D whose trail 
+          * cores all weigh at most T3Old (see 
+          * KK_TrailCoreCostFunction::getMaxWeight()) are not extended.  
+          */ 
+        void generate_KK_trailCoresFrom(long double T3Old);
+        /** It generates the 3-round trail cores of weight in (T3Min, T3] in 
+          * the file KK-trailCores-T3-<T3Min>-<T3>, eg to share a search 
+          * between machines by weight band. The files of the bands 
+          * (0, T3_1], (T3_1, T3_2], ... (T3_{n-1}, T3] hold together the 
+          * trail cores of generate_KK_trailCores(). 
+          */ 
+        void generate_KK_trailCoresInBand(long double T3Min);
+        /** It saves the @a k 3-round trail cores of lowest weight up to T3, 
+          * in ascending order of weight, by iterative deepening on the weight
+          * bound (see searchLowestWeightTrailCores()).
+          * @param  step  The increment of the bound between two traversals. 
+          */ 
+        void generateLowestWeightTrailCores(unsigned int k, unsigned int step = 2);
+    private: 
+        /** It traverses the tree of the activity patterns of C and D and 
+          * gives to @a output the 3-round trail cores up to @a maxWeight.
+          * @param  minWeight  Only the trail cores of weight strictly above
+          *                    are given to @a output. 
+          */ 
+        void traverse(long double maxWeight, 
+                      const function<void(const TrailCore&)>& output, 
+                      long double minWeight = 0);
 };
 
 #endif 
@@ -1,17 +1,23 @@
 /* backwardExtension.cpp */
+#include <algorithm>
 #include "backwardExtension.h"
 #include "state.h"
 
 TryteInfo::TryteInfo(const TrytePosition &aPosition, const Tryte & tryteAtC)
 {
-    Sbox sbox; 
     position = aPosition; 
-    possibleValues = sbox.inputDiff[(unsigned int) tryteAtC];
-    index = 0; 
+    setTryteAtC(tryteAtC); 
     mustCalculateTheCostOfTheSlice = false; 
     mustCalculateTheCostOfTheNextSlice = false; 
 }
 
+void TryteInfo::setTryteAtC(const Tryte& tryteAtC)
+{
+    Sbox sbox; 
+    possibleValues = sbox.inputDiff[(unsigned int) tryteAtC];
+    index = 0; 
+}
+
 void TryteInfo::setFirstValue(const BackwardExtensionCache& cache)
 { 
     (void) cache; 
@@ -49,9 +55,11 @@ ostream & operator << (ostream &fout, const TryteInfo &aTryteInfo)
     return fout;
 }
 
+ExtensionPartsOrder BackwardExtensionPreparation::partsOrder = slicePartsOrder; 
+
 BackwardExtensionPreparation::BackwardExtensionPreparation(
                                             const TroikaState &stateC, 
-                                            long double maxWeightExtension)
+                                            WeightBound maxWeightExtension)
 :maxWeightExtension(maxWeightExtension)
 {
     // Initialize the vector trytesInfoAtB
@@ -73,6 +81,7 @@ BackwardExtensionPreparation::BackwardExtensionPreparation(
             if (z == 0)
                 trytesInfoAtB.back().mustCalculateTheCostOfTheNextSlice = true; 
         }
+        sortTheTrytesOfTheSlices(); 
         return;
     } 
 
@@ -85,6 +94,21 @@ BackwardExtensionPreparation::BackwardExtensionPreparation(
         }
     }
     sort(firstZConsecutiveActiveSlices.begin(), firstZConsecutiveActiveSlices.end());
+    if (partsOrder == closingSlicesFirstPartsOrder) {
+        // the shortest runs of consecutive active slices first
+        auto runLength = [&sliceActive](unsigned int z) {
+            unsigned int length = 0; 
+            do {
+                length++; 
+                z = (z - 1 + SLICES) % SLICES; 
+            } while (sliceActive[z] == true);
+            return length; 
+        }; 
+        stable_sort(firstZConsecutiveActiveSlices.begin(), firstZConsecutiveActiveSlices.end(), 
+                    [&runLength](const pair<unsigned int, unsigned int>& a, 
+                                 const pair<unsigned int, unsigned int>& b) 
+                    { return runLength(a.second) < runLength(b.second); }); 
+    }
 
     vector<pair<unsigned int, unsigned int> >::const_iterator it; 
     for (it = firstZConsecutiveActiveSlices.begin(); it != firstZConsecutiveActiveSlices.end(); ++it) {
@@ -94,6 +118,61 @@ BackwardExtensionPreparation::BackwardExtensionPreparation(
             z = (z - 1 + SLICES) % SLICES; 
         } while (sliceActive[z] == true);
     }
+    sortTheTrytesOfTheSlices(); 
+}
+
+void BackwardExtensionPreparation::set(const TroikaState& stateC, 
+                                       WeightBound aMaxWeightExtension)
+{
+    if (!hasSameActiveTrytes(stateC)) {
+        WeightBound aMinWeightExtension = minWeightExtension; 
+        *this = BackwardExtensionPreparation(stateC, aMaxWeightExtension); 
+        minWeightExtension = aMinWeightExtension; 
+        return; 
+    }
+    maxWeightExtension = aMaxWeightExtension; 
+    vector<TryteInfo>::iterator it; 
+    for (it = trytesInfoAtB.begin(); it != trytesInfoAtB.end(); it++)
+        it->setTryteAtC(stateC.getTryte(it->position.x, it->position.y, it->position.z)); 
+    sortTheTrytesOfTheSlices(); 
+}
+
+bool BackwardExtensionPreparation::hasSameActiveTrytes(const TroikaState& stateC) const
+{
+    if (trytesInfoAtB.empty() || (stateC.getNrActiveTrytes() != trytesInfoAtB.size()))
+        return false; 
+    vector<TryteInfo>::const_iterator it; 
+    for (it = trytesInfoAtB.begin(); it != trytesInfoAtB.end(); it++) {
+        if (!stateC.isTryteActive(it->position.x, it->position.y, it->position.z))
+            return false; 
+    }
+    return true; 
+}
+
+void BackwardExtensionPreparation::sortTheTrytesOfTheSlices()
+{
+    if (partsOrder == slicePartsOrder)
+        return; 
+    vector<pair<size_t, size_t> >::const_iterator slice; 
+    for (slice = slices.begin(); slice != slices.end(); slice++) {
+        vector<TryteInfo>::iterator first = trytesInfoAtB.begin() + slice->first; 
+        vector<TryteInfo>::iterator last = trytesInfoAtB.begin() + slice->second; 
+        // the flags belong to the last tryte of the slice
+        bool mustCalculateTheCostOfTheSlice = (last - 1)->mustCalculateTheCostOfTheSlice; 
+        bool mustCalculateTheCostOfTheNextSlice = (last - 1)->mustCalculateTheCostOfTheNextSlice; 
+        (last - 1)->mustCalculateTheCostOfTheSlice = false; 
+        (last - 1)->mustCalculateTheCostOfTheNextSlice = false; 
+        // the ties are kept in the order of the positions, as in slicePartsOrder
+        sort(first, last, [](const TryteInfo& a, const TryteInfo& b) {
+            if (a.possibleValues.size() != b.possibleValues.size())
+                return a.possibleValues.size() < b.possibleValues.size(); 
+            if (a.position.x != b.position.x)
+                return a.position.x < b.position.x; 
+            return a.position.y < b.position.y; 
+        }); 
+        (last - 1)->mustCalculateTheCostOfTheSlice = mustCalculateTheCostOfTheSlice; 
+        (last - 1)->mustCalculateTheCostOfTheNextSlice = mustCalculateTheCostOfTheNextSlice; 
+    }
 }
 
 vector<TryteInfo>& BackwardExtensionPreparation::getPartsList()
@@ -105,6 +184,7 @@ void BackwardExtensionPreparation::addInfoOfTheTrytesOfTheSliceAtB(unsigned int
                                                                    const TroikaState &stateC)
 {
     
+    size_t firstOfTheSlice = trytesInfoAtB.size(); 
     for (unsigned int xTryte = 0; xTryte < 3; xTryte++) {
         for (unsigned y = 0; y < ROWS; y++) {
             if (stateC.isTryteActive(xTryte, y, z)) {
@@ -114,6 +194,7 @@ void BackwardExtensionPreparation::addInfoOfTheTrytesOfTheSliceAtB(unsigned int
             } 
         }
     }
+    slices.push_back(pair<size_t, size_t>(firstOfTheSlice, trytesInfoAtB.size())); 
     trytesInfoAtB.back().mustCalculateTheCostOfTheSlice = true;
     if (!stateC.isSliceActive((z - 1 + SLICES) % SLICES))
         trytesInfoAtB.back().mustCalculateTheCostOfTheNextSlice = true; 
@@ -282,9 +363,9 @@ maxWeightExtension(prep.maxWeightExtension), nrActiveTrytesB(prep.trytesInfoAtB.
 bool CostFunctionBackwardExtension::tooHighCost(
         const BackwardExtensionCache& cache, int indCurPart) const
 {
-    long double cost = 2 * (nrActiveTrytesB - indCurPart - 1)
-                       + (long double) cache.stackWeightBC.top()
-                       + 2 *  cache.nrActiveTrytesA;  
+    Weight cost = Weight(2 * (nrActiveTrytesB - indCurPart - 1))
+                  + cache.stackWeightBC.top()
+                  + Weight(2 *  cache.nrActiveTrytesA);  
     if (cost > maxWeightExtension)
         return true; 
     else 
@@ -308,13 +389,18 @@ void BackwardExtension::set(const vector<TryteInfo> trytesInfoAtB,
 
 }
 
-bool BackwardExtension::isValidAndBelowWeight(long double maxWeightExtension) const
+bool BackwardExtension::isValidAndBelowWeight(WeightBound maxWeightExtension) const
 {
-    if ( (long double)(wBC + wMinRevA)<= maxWeightExtension ) 
+    if ( (wBC + wMinRevA) <= maxWeightExtension ) 
         return true;  
     return false; 
 }
 
+bool BackwardExtension::isAboveWeight(WeightBound minWeightExtension) const
+{
+    return getWeight() > minWeightExtension; 
+}
+
     template<>
 bool BackwardExtensionIterator::next()
 {
@@ -63,6 +63,10 @@ class TryteInfo {
          *                  compatible through Subtrytes with tryteAtC.
          */
         TryteInfo(const TrytePosition& aPosition, const Tryte & tryteAtC);
+        /** It sets possibleValues to the values compatible through Subtrytes
+          * with @a tryteAtC, and the index to 0. 
+          */ 
+        void setTryteAtC(const Tryte& tryteAtC); 
         /** It sets  the first tryte value.
           * @param cache Not useful here.
           */ 
@@ -84,16 +88,45 @@ class TryteInfo {
 class BackwardExtensionPreparation 
 {
     public:
-        long double maxWeightExtension;
+        WeightBound maxWeightExtension;
+        /** Lower bound, excluded, on the weight of the extensions output by
+          * the iterator. It is 0 by default, which excludes none. 
+          */ 
+        WeightBound minWeightExtension; 
         vector<TryteInfo> trytesInfoAtB;
+        /** The order of the trytes in trytesInfoAtB, slicePartsOrder by 
+          * default. 
+          */ 
+        static ExtensionPartsOrder partsOrder; 
+    private: 
+        /** The index of the first tryte and the index after the last tryte of
+          * each slice in trytesInfoAtB. 
+          */ 
+        vector<pair<size_t, size_t> > slices; 
     public: 
-        BackwardExtensionPreparation(const TroikaState &stateC, long double maxWeightExtension); 
+        /** The default constructor. The preparation must be set with set()
+          * before it is used. 
+          */ 
+        BackwardExtensionPreparation() {} 
+        BackwardExtensionPreparation(const TroikaState &stateC, WeightBound maxWeightExtension); 
+        /** It prepares the extension of @a stateC. If @a stateC has the same
+          * active trytes as the state of the current preparation, only the 
+          * possible values of the trytes of B (and their order if it depends
+          * on them) are updated. Otherwise, the preparation is built again. 
+          */ 
+        void set(const TroikaState& stateC, WeightBound aMaxWeightExtension); 
+        /** It returns true if @a stateC has the same active trytes as the 
+          * state of the current preparation. 
+          */ 
+        bool hasSameActiveTrytes(const TroikaState& stateC) const; 
         /* @return A reference to the vector trytesInfoAtB. */
         vector<TryteInfo>& getPartsList();
         bool couldBeExtended() {return true; }
     private:
         void addInfoOfTheTrytesOfTheSliceAtB(unsigned int z,
                                              const TroikaState &stateAtC); 
+        /** It sorts the trytes of each slice according to partsOrder. */ 
+        void sortTheTrytesOfTheSlices(); 
         friend ostream & operator << (ostream &fout, const BackwardExtensionPreparation& prep);
 };
 
@@ -158,7 +191,7 @@ class BackwardExtensionCache
 class CostFunctionBackwardExtension
 {
     public: 
-        long double maxWeightExtension;
+        WeightBound maxWeightExtension;
         unsigned int nrActiveTrytesB;
 
     public: 
@@ -197,7 +230,11 @@ class BackwardExtension
           * the state C. It returns true if the weight of the extension is 
           * less than maxWeightExtension.
           */ 
-        bool isValidAndBelowWeight(long double maxWeightExtension) const;
+        bool isValidAndBelowWeight(WeightBound maxWeightExtension) const;
+        /** It returns true if the weight of the extension is strictly above
+          * @a minWeightExtension. 
+          */ 
+        bool isAboveWeight(WeightBound minWeightExtension) const;
     private: 
         Weight getWeight() const{return wBC + wMinRevA;}
 };
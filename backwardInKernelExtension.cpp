@@ -38,6 +38,12 @@ int InKernelTryteColumns::getHammingWeight() const
     return possibleValues[index].hammingWeight; 
 }
 
+Weight InKernelTryteColumns::getMaxCost() const
+{
+    assert(empty == false);
+    return possibleValues.back().weight + 2 * possibleValues.back().hammingWeight; 
+}
+
 bool sortbysecdesc(const pair<int, int> &a,
                    const pair<int, int> &b)
 {
@@ -79,7 +85,7 @@ ostream & operator << (ostream& fout, const InKernelTryteColumns& col)
 }
 
 BackwardInKernelExtensionPreparation::BackwardInKernelExtensionPreparation
-           (long double aMaxWeightExtension, const ActiveState& activeC): 
+           (WeightBound aMaxWeightExtension, const ActiveState& activeC): 
             maxWeightExtension(aMaxWeightExtension)
 {
     int nrActiveTrytesC = 0; 
@@ -110,7 +116,7 @@ BackwardInKernelExtensionPreparation::BackwardInKernelExtensionPreparation
     }
             
     toSubtractFromTheCost = 2 *( 3 * nrActiveTrytesC - possibleTrytesAtA.size());              
-    if ( ( 4 * nrActiveTrytesC - toSubtractFromTheCost ) > maxWeightExtension) 
+    if ( Weight(4 * nrActiveTrytesC) > maxWeightExtension + Weight(toSubtractFromTheCost)) 
         possible = false; 
      
     else 
@@ -131,11 +137,16 @@ void BackwardInKernelExtensionPreparation::prepareExtension(const TroikaState &s
     // initialize to add to the cost;
     toAddToTheCost.clear(); 
     toAddToTheCost.push_back(0); 
+    toAddToTheMaxCost.clear(); 
+    toAddToTheMaxCost.push_back(0); 
     Weight toAdd = 0; 
+    Weight toAddMax = 0; 
     for (int i = tryteColumnsAtB.size() - 1; i >= 0; i--) {
         toAdd += tryteColumnsAtB[i].getWeight()
                  + 2 * tryteColumnsAtB[i].getHammingWeight();
         toAddToTheCost.insert(toAddToTheCost.begin(), toAdd);
+        toAddMax += tryteColumnsAtB[i].getMaxCost(); 
+        toAddToTheMaxCost.insert(toAddToTheMaxCost.begin(), toAddMax);
     }
     possible = true;
 }
@@ -192,22 +203,31 @@ void BackwardInKernelExtensionCache::pop(const InKernelTryteColumns& tryteColumn
 CostFunctionBackwardInKernelExtension::CostFunctionBackwardInKernelExtension
 (BackwardInKernelExtensionPreparation &prep, const TroikaState& stateC) 
 : toAddToTheCost(prep.toAddToTheCost), toSubtractFromTheCost(prep.toSubtractFromTheCost), 
-    maxWeightExtension(prep.maxWeightExtension)
+    toAddToTheMaxCost(prep.toAddToTheMaxCost), maxWeightExtension(prep.maxWeightExtension), 
+    minWeightExtension(prep.minWeightExtension)
 { }
 
 bool CostFunctionBackwardInKernelExtension::tooHighCost(
         const BackwardInKernelExtensionCache& cache, int indCurPart) const
 {
-    long double cost = 2 * cache.hammingWeightA
-                      + (long double) cache.wBC 
-                      + (long double)toAddToTheCost[indCurPart + 1] 
-                       - toSubtractFromTheCost; 
-    if (cost > maxWeightExtension)
+    Weight cost = Weight(2 * cache.hammingWeightA)
+                  + cache.wBC 
+                  + toAddToTheCost[indCurPart + 1]; 
+    if (cost > maxWeightExtension + Weight(toSubtractFromTheCost))
         return true; 
     else 
         return false;
 }
 
+bool CostFunctionBackwardInKernelExtension::tooLowCost(
+        const BackwardInKernelExtensionCache& cache, int indCurPart) const
+{
+    Weight maxCost = Weight(2 * cache.hammingWeightA)
+                     + cache.wBC 
+                     + toAddToTheMaxCost[indCurPart + 1]; 
+    return maxCost <= minWeightExtension; 
+}
+
 void BackwardInKernelExtension::set(
                  const vector<InKernelTryteColumns> tryteColumnsAtB,
                  const BackwardInKernelExtensionCache &cache, 
@@ -227,16 +247,23 @@ void BackwardInKernelExtension::set(
 template<>                     
 bool BackwardInKernelExtensionIterator::next()
 {
+    // The values of a box-column are sorted by ascending cost: after a 
+    // node of too high cost, the siblings are skipped, but after a node of
+    // too low cost, the next sibling may be in the window. 
     if (toChild()) {
         if (costF.tooHighCost(cache, indCurPart))
             toParent(); 
-        else
+        else if (!costF.tooLowCost(cache, indCurPart))
             return true;
     }
     do {
-        if (toSibling())
-            if (!costF.tooHighCost(cache, indCurPart))
-                return true; 
+        if (toSibling()) {
+            if (!costF.tooHighCost(cache, indCurPart)) {
+                if (!costF.tooLowCost(cache, indCurPart))
+                    return true; 
+                continue; 
+            }
+        }
         if (!toParent())  
             return false; 
     } while (true); 
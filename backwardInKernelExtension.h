@@ -79,6 +79,10 @@ class InKernelTryteColumns
         Weight getWeight() const; 
         /** @return The Hamming weight of the current box-column. */
         int getHammingWeight() const;
+        /** @return The highest cost 2 * hammingWeight + weight of the 
+          *         possible values of the box-column. 
+          */ 
+        Weight getMaxCost() const;
         /* It initilizes the vector possibleValues.
          * @param state The state after the map Subtrytes. The box-column must
          *              be compatible with the box-column of @state. 
@@ -100,7 +104,11 @@ class InKernelTryteColumns
 class BackwardInKernelExtensionPreparation
 {
     public:
-        long double maxWeightExtension;
+        WeightBound maxWeightExtension;
+        /** Lower bound, excluded, on the weight of the extensions output by
+          * the iterator. It is 0 by default, which excludes none. 
+          */ 
+        WeightBound minWeightExtension; 
         bool possible;
         /** Attribute for the initialization of the vector partsList of the 
           * BackwardInKernelExtensionIterator.
@@ -110,8 +118,13 @@ class BackwardInKernelExtensionPreparation
         vector<Weight> toAddToTheCost;
         /** Attribute that is going to be used by CostFunctionBackwardInKernelExtension. */
         int toSubtractFromTheCost;
+        /** Attribute that is going to be used by CostFunctionBackwardInKernelExtension. 
+          * toAddToTheMaxCost[i] is the sum of the highest costs of the 
+          * box-columns i, i + 1, ... 
+          */
+        vector<Weight> toAddToTheMaxCost;
     public: 
-        BackwardInKernelExtensionPreparation(long double aMaxWeightExtension, 
+        BackwardInKernelExtensionPreparation(WeightBound aMaxWeightExtension, 
                                              const ActiveState& activeC);
         void prepareExtension(const TroikaState &stateC);
         bool couldBeExtended() const; 
@@ -140,15 +153,23 @@ class BackwardInKernelExtensionCache
 class CostFunctionBackwardInKernelExtension
 {
     public: 
-        long double maxWeightExtension; 
+        WeightBound maxWeightExtension; 
+        WeightBound minWeightExtension; 
         /** Attributes used to compute the cost of a node, as explained in 
           * Appendix C.1
           */
         vector<Weight>& toAddToTheCost; 
         int toSubtractFromTheCost;
+        vector<Weight>& toAddToTheMaxCost; 
     public:
         CostFunctionBackwardInKernelExtension(BackwardInKernelExtensionPreparation &prep, const TroikaState& stateC); 
         bool tooHighCost(const BackwardInKernelExtensionCache& cache, int indCurPart) const;
+        /** It returns true if all the extensions of the subtree of the node
+          * weigh at most minWeightExtension. As wMinRev(A) is at most twice 
+          * the Hamming weight of A, the cost of the chosen box-columns plus
+          * the highest costs of the other ones bound these weights. 
+          */ 
+        bool tooLowCost(const BackwardInKernelExtensionCache& cache, int indCurPart) const;
 };
 
 /** The output representation for a backward extension. */
@@ -4,6 +4,8 @@
 #include "traversal.h"
 #include "troikaStateIterator.h"
 #include "types.h"
+#include <algorithm>
+#include <cassert>
 #include <iterator>
 #include <vector>
 
@@ -470,8 +472,7 @@ void BareStateCache::pop(const Column& col)
 
 void BareStateCache::iterateEntanglement(vector<Column> &unitList, Column& current)
 {
-    vector <bool> supraUnitFound(indexLastSupraUnit + 1 , false);
-    vector<unsigned int> indexes = getUnitIndexesOfAComponent(supraUnitIndexes[current.x][current.z], supraUnitFound);
+    vector<unsigned int> indexes = getUnitIndexesOfAComponent(supraUnitIndexes[current.x][current.z]);
 
     for (vector<unsigned int>::const_iterator ind = indexes.begin(); ind != indexes.end(); ind++) {
           
@@ -494,68 +495,53 @@ void BareStateCache::iterateEntanglement(vector<Column> &unitList, Column& curre
 
 bool BareStateCache::lastSupraUnitInTheComponentOf(unsigned int index) const
 {
-    int supraUnit;
-    list<int>::const_iterator i;
-    map<int, bool> visited;
-    queue<int> fifo;
-
-    fifo.push(indexLastSupraUnit);
-    visited[indexLastSupraUnit] = true;
-    while (!fifo.empty()) {
-        supraUnit = fifo.front(); 
-        fifo.pop();
-        for (i = neighborsSupraUnit[supraUnit].begin();
-             i != neighborsSupraUnit[supraUnit].end(); ++i) {
-            if (*i == index)
-                return true;
-            if (!visited[*i]) {
-                fifo.push(*i); 
-                visited[*i] = true; 
-            }
-        }
-    }
-    return false; 
+    return getRepresentative(indexLastSupraUnit) == getRepresentative(index); 
 }
 
 vector<vector<unsigned int>> BareStateCache::getUnitIndexesOfAllTheComponents() const
 {  
     vector<vector<unsigned int>> components;
-    queue<int> fifo;
-    vector<bool> supraUnitFound(neighborsSupraUnit.size(), false); 
-    for (unsigned int indexSupraUnit = 0; indexSupraUnit != indexLastSupraUnit + 1; indexSupraUnit++) {
-        if (supraUnitFound[indexSupraUnit] == false) 
-            components.push_back(getUnitIndexesOfAComponent(indexSupraUnit, supraUnitFound));
+    vector<bool> supraUnitFound(indexLastSupraUnit + 1, false); 
+    for (int indexSupraUnit = 0; indexSupraUnit <= indexLastSupraUnit; indexSupraUnit++) {
+        if (supraUnitFound[indexSupraUnit] == false) {
+            // mark the whole component, its smallest index is indexSupraUnit
+            int supraUnit = indexSupraUnit; 
+            do {
+                supraUnitFound[supraUnit] = true; 
+                supraUnit = nextSupraUnitInTheComponent[supraUnit]; 
+            } while (supraUnit != indexSupraUnit); 
+            components.push_back(getUnitIndexesOfAComponent(indexSupraUnit));
+        }
     }
     return components;
 }
 
+int BareStateCache::getRepresentative(int supraUnitIndex) const
+{
+    while (parentSupraUnit[supraUnitIndex] != supraUnitIndex)
+        supraUnitIndex = parentSupraUnit[supraUnitIndex]; 
+    return supraUnitIndex; 
+}
+
 vector<unsigned int> BareStateCache::getUnitIndexesOfAComponent(
-                                unsigned int supraUnitIndexOfTheComponent, 
-                                vector<bool>& supraUnitFound) const
+                                unsigned int supraUnitIndexOfTheComponent) const
 {
+    vector<unsigned int> supraUnits; 
     vector<unsigned int> unitIndexes; 
-    queue<unsigned int> fifo;
-    int supraUnit; 
-    list<int>::const_iterator i;
-
-    fifo.push(supraUnitIndexOfTheComponent);
-    supraUnitFound[supraUnitIndexOfTheComponent] = true; 
-   
-    while (!fifo.empty()) {
-        supraUnit = fifo.front(); 
+    int supraUnit = supraUnitIndexOfTheComponent; 
+    do {
+        supraUnits.push_back(supraUnit); 
+        supraUnit = nextSupraUnitInTheComponent[supraUnit]; 
+    } while (supraUnit != (int)supraUnitIndexOfTheComponent); 
+    sort(supraUnits.begin(), supraUnits.end()); 
+
+    for (unsigned int k = 0; k < supraUnits.size(); k++) {
+        supraUnit = supraUnits[k]; 
         unsigned int start = startSupraUnit[supraUnit]; 
         unsigned int end   = (supraUnit == indexLastSupraUnit) ? (indexLastUnit + 1): startSupraUnit[supraUnit + 1]; 
         for (unsigned int i = start; i != end; i++) { 
             unitIndexes.push_back(i); 
         }
-        fifo.pop();
-        for (i = neighborsSupraUnit[supraUnit].begin();
-             i != neighborsSupraUnit[supraUnit].end(); ++i) {
-            if (supraUnitFound[*i] == false) {
-                fifo.push(*i); 
-                supraUnitFound[*i] = true; 
-            }
-        } 
     }
     return unitIndexes; 
 }
@@ -588,33 +574,96 @@ void BareStateCache::pushOrPopTritAtAAndB(bool push, const TritAtAAndB& trit)
 
 void BareStateCache::addSupraUnit()
 {
-    neighborsSupraUnit.push_back(list<int>());
     indexLastSupraUnit++;
+    parentSupraUnit.push_back(indexLastSupraUnit);
+    sizeComponent.push_back(1); 
+    nextSupraUnitInTheComponent.push_back(indexLastSupraUnit); 
     startSupraUnit.push_back(indexLastUnit);
 }
 
 void BareStateCache::removeLastSupraUnit()
 {
-    neighborsSupraUnit.pop_back(); 
+    // All the edges of the last supra-unit have already been removed.
+    assert(parentSupraUnit.back() == indexLastSupraUnit); 
+    parentSupraUnit.pop_back(); 
+    sizeComponent.pop_back(); 
+    nextSupraUnitInTheComponent.pop_back(); 
     indexLastSupraUnit--; 
     startSupraUnit.pop_back();
 }
 
 void BareStateCache::addSupraUnitNeighbor(unsigned int index)
 {
-    neighborsSupraUnit[index].push_back(indexLastSupraUnit); 
-    neighborsSupraUnit[indexLastSupraUnit].push_back(index);
+    int root     = getRepresentative(index); 
+    int lastRoot = getRepresentative(indexLastSupraUnit); 
+    if (root == lastRoot) {
+        unionHistory.push_back(-1); 
+        return; 
+    }
+    // union by size
+    if (sizeComponent[root] < sizeComponent[lastRoot])
+        swap(root, lastRoot); 
+    parentSupraUnit[lastRoot] = root; 
+    sizeComponent[root] += sizeComponent[lastRoot]; 
+    // splice the two circular lists 
+    swap(nextSupraUnitInTheComponent[index], 
+         nextSupraUnitInTheComponent[indexLastSupraUnit]); 
+    unionHistory.push_back(lastRoot); 
 }
 
 void BareStateCache::removeSupraUnitNeighbor(unsigned int index)
 {
-    neighborsSupraUnit[indexLastSupraUnit].pop_back(); 
-    neighborsSupraUnit[index].pop_back(); 
+    int attachedRoot = unionHistory.back(); 
+    unionHistory.pop_back(); 
+    if (attachedRoot == -1)
+        return; 
+    int root = parentSupraUnit[attachedRoot]; 
+    parentSupraUnit[attachedRoot] = attachedRoot; 
+    sizeComponent[root] -= sizeComponent[attachedRoot]; 
+    // the same swap splits the circular list again
+    swap(nextSupraUnitInTheComponent[index], 
+         nextSupraUnitInTheComponent[indexLastSupraUnit]); 
 } 
 
 
 unsigned int TwoRoundTrailCoreCostBoundFunction::
            getCost(const vector<Column>& unitList, const BareStateCache& cache) const
+{
+    if (alpha2 == 0 && beta2 == 0)
+        return getCost(unitList, cache, alpha, beta); 
+
+    size_t depth = unitList.size(); 
+    if (regions.size() <= depth)
+        regions.resize(depth + 1); 
+    UINT8 parentRegions = regions[depth - 1]; 
+    if (parentRegions & 0x1) {
+        unsigned int cost = getCost(unitList, cache, alpha, beta); 
+        if (cost <= maxCost) {
+            regions[depth] = parentRegions; 
+            return cost; 
+        }
+    }
+    if ((parentRegions & 0x2) && (getCost(unitList, cache, alpha2, beta2) <= maxCost2)) {
+        regions[depth] = 0x2; 
+        return maxCost; 
+    }
+    regions[depth] = 0; 
+    return maxCost + 1; 
+}
+
+unsigned int TwoRoundTrailCoreCostBoundFunction::getCost(unsigned int wA, unsigned int wB) const
+{
+    unsigned int cost = alpha * wA + beta * wB; 
+    if ((alpha2 == 0 && beta2 == 0) || (cost <= maxCost))
+        return cost; 
+    if (alpha2 * wA + beta2 * wB <= maxCost2)
+        return maxCost; 
+    return cost; 
+}
+
+unsigned int TwoRoundTrailCoreCostBoundFunction::
+           getCost(const vector<Column>& unitList, const BareStateCache& cache,
+                   unsigned int alpha, unsigned int beta) const
 {
     int contributionNewStable = 0; 
     unsigned int contributionUnstable = 0; 
@@ -644,7 +693,8 @@ unsigned int TwoRoundTrailCoreCostBoundFunction::
 
     // Get the contribution of the unstable trits
     for (vector<TritAtAAndB>::const_iterator trit = unstable.begin(); trit != unstable.end(); trit++) 
-        contributionUnstable += getContributionUnstableTrit(*trit, possibleActiveTritsA, possibleActiveTritsB);
+        contributionUnstable += getContributionUnstableTrit(*trit, possibleActiveTritsA, possibleActiveTritsB,
+                                                            alpha, beta);
       
     return contributionNewStable + contributionUnstable
            + 2 * alpha * cache.nrStableTrytesA + 2 * beta * cache.nrStableTrytesB; 
@@ -671,7 +721,8 @@ unsigned int TwoRoundTrailCoreCostBoundFunction::
            getContributionUnstableTrit(
                                  const TritAtAAndB& trit, 
                                  ActiveState& possibleActiveTritsA, 
-                                 ActiveState& possibleActiveTritsB) const
+                                 ActiveState& possibleActiveTritsB,
+                                 unsigned int alpha, unsigned int beta) const
 {
     // Use the three activity invariants described in the paragraph 
     // "Lower bounding the cost" of Section 5.4.
@@ -756,19 +807,18 @@ void BareState::set(const vector<Column>& unitList,
                     const TwoRoundTrailCoreCostBoundFunction& costF, 
                     unsigned int aMaxCost)
 {
-    unsigned int cost =  costF.alpha * 2 * cache.nrActiveTrytesA
-                       + costF.beta * 2 * cache.nrActiveTrytesB;
+    unsigned int cost = costF.getCost(2 * cache.nrActiveTrytesA, 2 * cache.nrActiveTrytesB);
     if (cost > aMaxCost || unitList.back().ending == false) 
         valid = false; 
     else {
         valid = true;
-        stateA = cache.stateA; 
-        stateB = cache.stateB; 
+        stateA = &cache.stateA; 
+        stateB = &cache.stateB; 
         wA = 2 * cache.nrActiveTrytesA; 
         wB = 2 * cache.nrActiveTrytesB;
 
         // initialize firstActiveTritsAllowed and outKernelComponentsColumns
-        firstActiveTritsAllowed = vector<UINT8>(COLUMNS * SLICES, 0x3);
+        firstActiveTritsAllowed.assign(COLUMNS * SLICES, 0x3);
         outKernelComponentsColumns.clear();
 
         vector<vector<unsigned int>> componentsIndexes = cache.getUnitIndexesOfAllTheComponents();
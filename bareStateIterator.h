@@ -17,8 +17,6 @@ parity-bare (see section 5.3).
 #include <vector>
 #include <algorithm>
 #include <iostream>
-#include <list>
-#include <queue>
 #include <map>
 #include <assert.h>
 #include "types.h"
@@ -252,8 +250,29 @@ class BareStateCache
         int indexLastSupraUnit;
         /** Index of the last unit added to the unit-list. */ 
         int indexLastUnit;
-        /** Graph used to organize the components of rho(A). See Section 5.5. */ 
-        vector<list<int>> neighborsSupraUnit;
+        /** Union-find structure used to organize the components of rho(A).
+          * See Section 5.5. For 0 ≤ i ≤ indexLastSupraUnit, 
+          * parentSupraUnit[i] is the parent of the supra-unit of index i in 
+          * the forest. The supra-unit is the representative of its component
+          * if parentSupraUnit[i] == i. There is no path compression, so that
+          * every union can be undone when the units are popped. 
+          */
+        vector<int> parentSupraUnit; 
+        /** For a representative i, sizeComponent[i] is the number of 
+          * supra-units of its component. It is used for the union by size. 
+          */ 
+        vector<unsigned int> sizeComponent;
+        /** The supra-units of a component form a circular list : 
+          * nextSupraUnitInTheComponent[i] is the supra-unit that follows 
+          * the supra-unit of index i in the list of its component. 
+          */ 
+        vector<int> nextSupraUnitInTheComponent;
+        /** Each edge added to the supra-unit graph pushes the index of the
+          * representative that was attached to another representative, or -1
+          * if the edge did not merge two components. It is used to undo the
+          * unions in the reverse order.
+          */ 
+        vector<int> unionHistory;
     public:
         BareStateCache();  
         void pushDummy(); 
@@ -279,25 +298,26 @@ class BareStateCache
           */
         bool lastSupraUnitInTheComponentOf(unsigned int index) const;
         /** It returns a vector of the form <C1, C2, ..., Cn> where Ci 
-          * is a vector that stores all the supra-unit indexes of a 
-          * component of rho(A).
+          * is a vector that stores all the unit indexes of a 
+          * component of rho(A). The components are sorted by their smallest 
+          * supra-unit index. 
           */ 
         vector<vector<unsigned int>> getUnitIndexesOfAllTheComponents() const; 
     private:
-        /** It gets the indexes of a component and indicates in the vector
-         * @supraUnitFound that these indexes have been found. 
-          * @param supraUnitIndexOfTheComponent An index of a component of 
+        /** It returns the representative of the component of the supra-unit
+          * of index @supraUnitIndex.
+          */ 
+        int getRepresentative(int supraUnitIndex) const;
+        /** It gets the indexes of the units of a component.
+          * @param supraUnitIndexOfTheComponent An index of a supra-unit of 
           *                                     rho(A), between 0 and
-          *                                     neighborsSupraUnit.size() - 1
-          * @param supraUnitFound  A vector whose size is equal to the number 
-          *                        of components of rho(A). 
-          * @return A vector whose elements are the indexes of the supra-unit 
-          *         that are in the same component as the supra-unit of index 
-          *         @supraUnitIndexOfTheComponent. 
+          *                                     indexLastSupraUnit.
+          * @return A vector whose elements are the indexes, in ascending
+          *         order, of the units that are in the same component as 
+          *         the supra-unit of index @supraUnitIndexOfTheComponent. 
           */ 
        vector<unsigned int> getUnitIndexesOfAComponent(
-                                unsigned int supraUnitIndexOfTheComponent,
-                                vector<bool>& supraUnitFound) const;
+                                unsigned int supraUnitIndexOfTheComponent) const;
        /** Auxiliary function for the method push and pop that updates
          * the attributes nrActiveTrytesA, stateA, nrActiveTrytesB, stateB, 
          * nrStableTrytesA, nrStableTrytesB, stableTritsA, stableTritsB and 
@@ -307,11 +327,13 @@ class BareStateCache
         void addSupraUnit();
         void removeLastSupraUnit();
         /** It adds to the graph used to organize the components of rho(A) an 
-          * edge between the index of the current supra-unit and @index.
+          * edge between the index of the current supra-unit and @index, ie it
+          * merges their components.
           */ 
         void addSupraUnitNeighbor(unsigned int index);
         /** It removes from the graph used to organize the components of rho(A)
           * the edge between the index of the current supra-unit and @index.
+          * The edge must be the last one that was added.
           */ 
         void removeSupraUnitNeighbor(unsigned int index);
 };
@@ -319,36 +341,75 @@ class BareStateCache
 /** Class used to compute a lower bound on the costs 
   * alpha * wMinRev(A) + beta * wMinDir(B) of a nodes (A, B) and its
   * its descendants. 
+  * With a second weighting (alpha2, beta2) and two maximum costs maxCost and
+  * maxCost2, a traversal with the maximum cost maxCost covers the union of the
+  * region of cost at most maxCost for the first weighting and the region of 
+  * cost at most maxCost2 for the second one: the cost of a node above maxCost
+  * for the first weighting but not above maxCost2 for the second one is set 
+  * to maxCost. As the bounds of the descendants of a node are not lower than 
+  * its bounds, a bound is only computed for a node if its parent is in the 
+  * corresponding region, and the second bound only if the node is above 
+  * maxCost for the first weighting. 
   */ 
 class TwoRoundTrailCoreCostBoundFunction
 {
     public: 
         unsigned int alpha; 
         unsigned int beta;
+        /** The second weighting, not used if alpha2 = beta2 = 0. */ 
+        unsigned int alpha2; 
+        unsigned int beta2; 
+        unsigned int maxCost; 
+        unsigned int maxCost2; 
+    private: 
+        /** For each depth, the regions that may contain the current node of 
+          * that depth and its descendants: bit 0 for the first weighting, 
+          * bit 1 for the second one. The root is in both regions. 
+          */ 
+        mutable vector<UINT8> regions; 
     public: 
         TwoRoundTrailCoreCostBoundFunction(unsigned int aAlpha, unsigned int aBeta)
-            : alpha(aAlpha), beta(aBeta){};
+            : alpha(aAlpha), beta(aBeta), alpha2(0), beta2(0), maxCost(0), maxCost2(0){};
+        TwoRoundTrailCoreCostBoundFunction(unsigned int aAlpha, unsigned int aBeta,
+                                           unsigned int aMaxCost, 
+                                           unsigned int aAlpha2, unsigned int aBeta2,
+                                           unsigned int aMaxCost2)
+            : alpha(aAlpha), beta(aBeta), alpha2(aAlpha2), beta2(aBeta2), 
+              maxCost(aMaxCost), maxCost2(aMaxCost2), regions(1, 0x3){};
         /** It returns a lower bound on the costs of a unit-list and its 
           * descendants computed using Algorithm 1 of Appendix A.
           */ 
         unsigned int getCost(const vector<Column>& unitList, 
                              const BareStateCache& cache) const;
+        /** It returns the cost of a node (A, B) with wMinRev(A) = @wA and 
+          * wMinDir(B) = @wB. 
+          */ 
+        unsigned int getCost(unsigned int wA, unsigned int wB) const; 
     private:
+        unsigned int getCost(const vector<Column>& unitList, 
+                             const BareStateCache& cache,
+                             unsigned int aAlpha, unsigned int aBeta) const;
         bool isTritStillUnstable(const TritAtAAndB& trit,
                                  const BareStateCache& cache,
                                  const vector<Column>& unitList) const; 
         unsigned int getContributionUnstableTrit(
                                  const TritAtAAndB& trit, 
                                  ActiveState& possibleActiveTritsA, 
-                                 ActiveState& possibleActiveTritsB) const; 
+                                 ActiveState& possibleActiveTritsB,
+                                 unsigned int aAlpha, unsigned int aBeta) const; 
 };
 
-/** The output representation of a trail core (A, B). */ 
+/** The output representation of a trail core (A, B). The states are 
+  * borrowed from the cache, so it is only valid until the iterator is 
+  * incremented. 
+  */ 
 class BareState
 {
     public: 
-        TroikaState stateA; 
-        TroikaState stateB;
+        /** The state A, borrowed from the cache of the iterator. */ 
+        const TroikaState* stateA; 
+        /** The state B, borrowed from the cache of the iterator. */ 
+        const TroikaState* stateB;
         /** The minimum reverse weight of A. */ 
         unsigned int wA; 
         /** The minimum direct weight of B. */ 
@@ -367,7 +428,7 @@ class BareState
           */ 
         bool valid; 
     public : 
-        BareState(){}
+        BareState(): stateA(NULL), stateB(NULL){}
         /** It indicates if the current node is a valid trail core. If it is 
           * the case, the attributes of the current BareState are updated. 
           */ 
@@ -0,0 +1,103 @@
+/* benchmark.h */
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+/*
+The functions of this file are used by the benchmark executables to time a
+piece of code with stable statistics: the code is first run a few times to
+warm up the caches, then it is timed over several repetitions and the median
+and the median absolute deviation (MAD) of the repetitions are reported.
+
+The results are printed as CSV lines
+    benchmark,repetitions,iterations,median_ns,mad_ns,min_ns
+where the times are per iteration, so that they can be compared between
+releases by a script.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/** The statistics of a benchmark. The times are in nanoseconds per iteration. */
+class BenchmarkResult {
+    public:
+        string name;
+        unsigned int repetitions;
+        unsigned int iterations;
+        double median;
+        double mad;
+        double min;
+    public:
+        /** It prints the header of the CSV output. */
+        static void printHeader(ostream& fout)
+        {
+            fout << "benchmark,repetitions,iterations,median_ns,mad_ns,min_ns" << endl;
+        }
+        /** It prints the result as a CSV line. */
+        void print(ostream& fout) const
+        {
+            fout << name << "," << dec << repetitions << "," << iterations << ",";
+            fout << median << "," << mad << "," << min << endl;
+        }
+};
+
+/** It returns the median of @a values, which is reordered. */
+inline double median(vector<double>& values)
+{
+    size_t middle = values.size() / 2;
+    nth_element(values.begin(), values.begin() + middle, values.end());
+    double upper = values[middle];
+    if (values.size() % 2 == 1)
+        return upper;
+    double lower = *max_element(values.begin(), values.begin() + middle);
+    return (lower + upper) / 2;
+}
+
+/** It times @a code, which is called with the index of the iteration.
+  * @param name         The name of the benchmark.
+  * @param code         The code to time.
+  * @param iterations   The number of calls of @a code per repetition.
+  * @param repetitions  The number of timed repetitions.
+  * @param warmup       The number of repetitions run before timing.
+  * @return The statistics of the timed repetitions.
+  */
+template<class Code>
+BenchmarkResult runBenchmark(const string& name, Code code,
+                             unsigned int iterations,
+                             unsigned int repetitions,
+                             unsigned int warmup = 3)
+{
+    typedef chrono::steady_clock Clock;
+    vector<double> times;
+    for (unsigned int r = 0; r < warmup + repetitions; r++) {
+        Clock::time_point start = Clock::now();
+        for (unsigned int i = 0; i < iterations; i++)
+            code(i);
+        Clock::time_point ending = Clock::now();
+        if (r >= warmup)
+            times.push_back(chrono::duration<double, nano>(ending - start).count() / iterations);
+    }
+    BenchmarkResult result;
+    result.name = name;
+    result.repetitions = repetitions;
+    result.iterations = iterations;
+    result.min = *min_element(times.begin(), times.end());
+    result.median = median(times);
+    vector<double> deviations;
+    for (unsigned int r = 0; r < times.size(); r++)
+        deviations.push_back(times[r] > result.median ? times[r] - result.median
+                                                      : result.median - times[r]);
+    result.mad = median(deviations);
+    return result;
+}
+
+/** Variable written by the benchmarks so that the compiler cannot remove
+  * the code being timed.
+  */
+static volatile unsigned int benchmarkSink;
+
+#endif
@@ -0,0 +1,212 @@
+/* estimateTreeSize.cpp */
+
+/*
+Estimation of the size of the trees traversed by the tree iterators, before
+running a search: the number of nodes and of leaves of the tree are estimated
+with Knuth's random probes (see GenericTreeIterator::estimateSize), and the
+wall time of the traversal is projected with a per-node cost calibrated by
+running the real traversal for a short time.
+
+Build and run from the root of the repository, eg:
+    g++ -std=c++17 -O2 -pthread -I. benchmark/estimateTreeSize.cpp \
+        $(ls *.cpp | grep -v main.cpp) -o estimateTreeSize
+    ./estimateTreeSize [--probes n] [--width w] [--seed s] [--calibration sec]
+                       [--check] tree
+where tree is one of
+    KK <T3>                          ActiveStatesCAndDIterator
+    K <maxCost> <alpha> <beta>       K_TrailCore_Iterator
+    BARE <maxCost> <alpha> <beta>    BareStateIterator
+    N <maxCost> <alpha> <beta>       BareStateIterator and, for each valid
+                                     bare state, N_TrailCore_Iterator
+For instance, the trees of KN_FromInKernelExtension for T3 = 27 and T1 = 7
+are estimated with "N 18 1 1", and those of K_TrailCores with "K 7 1 0".
+
+By default, 1000 probes of width 1 are run and the calibration lasts one
+second. If the traversal ends during the calibration, the exact number of
+nodes is printed as well. The per-node cost only covers the traversal: the
+work done by a search for each node (eg the extensions) is not included.
+The estimation is printed, then written as a JSON object on the last line.
+
+The KK tree skips the valid patterns already found, which depends on the order
+of the traversal. The probes, and the calibration, use the tree where every
+valid pattern is kept (see ActiveStatesCAndDCache::uniquePatterns), so the
+estimation is an upper bound on the tree of the search (2538 nodes instead of
+2390 for T3 = 27).
+
+With --check, the calibration must traverse the whole tree, and the program
+fails if the exact number of nodes is outside the confidence interval of the
+estimation. It is meant for the trees KK, K and BARE with small bounds, eg:
+    ./estimateTreeSize --check --probes 10000 --width 3 KK 27
+    ./estimateTreeSize --check --probes 10000 --width 3 K 9 1 0
+    ./estimateTreeSize --check --probes 10000 --width 3 BARE 12 1 1
+The estimator has a heavy tail with one probe per node (width 1), so the
+check uses a wider probe.
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+#include "bareStateIterator.h"
+#include "KK_trailCores.h"
+#include "mixedStateIterator.h"
+
+typedef chrono::steady_clock Clock;
+
+/** The result of the calibration of the per-node cost. */
+class Calibration {
+    public:
+        double secondsPerNode;
+        /** The number of nodes visited (nested nodes included). */
+        unsigned long long nodes;
+        /** Whether the whole tree was traversed, in which case nodes is exact. */
+        bool complete;
+};
+
+/** It runs @a iterator for at most @a seconds seconds; @a visit is called for
+  * each node and returns the number of nested nodes visited.
+  */
+template<class Iterator, class Visit>
+Calibration calibrate(Iterator& iterator, double seconds, Visit visit)
+{
+    Calibration calibration;
+    calibration.nodes = 0;
+    Clock::time_point start = Clock::now();
+    double elapsed = 0;
+    for (; !iterator.isEnd() && elapsed < seconds; ++iterator) {
+        calibration.nodes += 1 + visit(*iterator);
+        elapsed = chrono::duration<double>(Clock::now() - start).count();
+    }
+    calibration.complete = iterator.isEnd();
+    elapsed = chrono::duration<double>(Clock::now() - start).count();
+    calibration.secondsPerNode = (calibration.nodes > 0) ? elapsed / calibration.nodes : 0;
+    return calibration;
+}
+
+/** It prints an estimation with its 95% confidence interval. */
+void printEstimation(const string& name, double estimation, double stdError)
+{
+    cout << name << ": " << estimation << " [" << max(0.0, estimation - 1.96 * stdError);
+    cout << ", " << estimation + 1.96 * stdError << "]" << endl;
+}
+
+void printEstimate(const TreeSizeEstimate& estimate, const Calibration& calibration)
+{
+    cout << estimate.nrProbes << " probes" << endl;
+    printEstimation("nodes", estimate.nodes, estimate.nodesStdError);
+    printEstimation("leaves", estimate.leaves, estimate.leavesStdError);
+    if (estimate.nestedNodes > 0)
+        printEstimation("nested nodes", estimate.nestedNodes, estimate.nestedNodesStdError);
+    if (calibration.complete)
+        cout << "exact number of nodes (nested nodes included): " << calibration.nodes << endl;
+    cout << "seconds per node: " << estimate.secondsPerNode << endl;
+    cout << "projected time: " << estimate.getProjectedSeconds() << " s" << endl;
+    estimate.saveJSON(cout);
+    cout << endl;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int nrProbes = 1000;
+    unsigned int width = 1;
+    unsigned long long seed = 0;
+    double calibrationSeconds = 1.0;
+    bool check = false;
+    vector<string> tree;
+    for (int i = 1; i < argc; i++) {
+        string argument = argv[i];
+        if (argument == "--probes" && i + 1 < argc)
+            nrProbes = atoi(argv[++i]);
+        else if (argument == "--width" && i + 1 < argc)
+            width = max(1, atoi(argv[++i]));
+        else if (argument == "--seed" && i + 1 < argc)
+            seed = strtoull(argv[++i], NULL, 10);
+        else if (argument == "--calibration" && i + 1 < argc)
+            calibrationSeconds = atof(argv[++i]);
+        else if (argument == "--check")
+            check = true;
+        else
+            tree.push_back(argument);
+    }
+    bool isKK = (tree.size() == 2 && tree[0] == "KK");
+    bool isTwoRounds = (tree.size() == 4 && (tree[0] == "K" || tree[0] == "BARE" || tree[0] == "N"));
+    if (!isKK && !isTwoRounds) {
+        cerr << "Usage: " << argv[0] << " [--probes n] [--width w] [--seed s] [--calibration sec] [--check]" << endl;
+        cerr << "       (KK <T3> | K <maxCost> <alpha> <beta> | BARE <maxCost> <alpha> <beta>" << endl;
+        cerr << "        | N <maxCost> <alpha> <beta>)" << endl;
+        return 2;
+    }
+
+    mt19937_64 generator(seed);
+    TreeSizeEstimate estimate;
+    Calibration calibration;
+    if (isKK) {
+        ActiveTritsAtCAndDSet KKSet;
+        ActiveStatesCAndDCache KKCache;
+        KKCache.uniquePatterns = false;
+        KK_TrailCoreCostFunction KKCostF;
+        unsigned int T3 = atoi(tree[1].c_str());
+        ActiveStatesCAndDIterator probes(KKSet, KKCache, KKCostF, T3, false);
+        estimate = probes.estimateSize(nrProbes, width, generator);
+        ActiveStatesCAndDIterator it(KKSet, KKCache, KKCostF, T3, true);
+        calibration = calibrate(it, calibrationSeconds,
+                                [](const ActiveStatesCAndD&) { return 0; });
+    } else {
+        unsigned int maxCost = atoi(tree[1].c_str());
+        unsigned int alpha = atoi(tree[2].c_str());
+        unsigned int beta = atoi(tree[3].c_str());
+        if (tree[0] == "K") {
+            TwoRoundTrailCoreCostFunction costF(alpha, beta);
+            ActiveTrailCoreCache activeTritsCache;
+            ActiveTritsSet activeTritsSet;
+            K_TrailCore_Iterator probes(activeTritsSet, activeTritsCache, costF, maxCost, false);
+            estimate = probes.estimateSize(nrProbes, width, generator);
+            K_TrailCore_Iterator it(activeTritsSet, activeTritsCache, costF, maxCost, true);
+            calibration = calibrate(it, calibrationSeconds,
+                                    [](const TwoRoundTrailCore&) { return 0; });
+        } else {
+            TwoRoundTrailCoreCostBoundFunction costFBareState(alpha, beta);
+            TwoRoundTrailCoreCostFunction costFTrits(alpha, beta);
+            ColumnsSet colSet;
+            BareStateCache bareStateCache;
+            bool nested = (tree[0] == "N");
+            // one probe of the N_TrailCore_Iterator tree per bare state reached
+            auto estimateNested = [&](const BareState& bareState) {
+                if (!nested || !bareState.valid)
+                    return 0.0;
+                MixedTrailCoreCache mixedCache(bareState);
+                ActiveTritsSet activeTritsSet(bareState.firstActiveTritsAllowed);
+                N_TrailCore_Iterator probes(activeTritsSet, mixedCache, costFTrits, maxCost, false);
+                return probes.estimateSize(1, width, generator).nodes;
+            };
+            BareStateIterator probes(colSet, bareStateCache, costFBareState, maxCost, false);
+            estimate = probes.estimateSize(nrProbes, width, generator, estimateNested);
+            auto visitNested = [&](const BareState& bareState) {
+                unsigned long long nodes = 0;
+                if (nested && bareState.valid) {
+                    MixedTrailCoreCache mixedCache(bareState);
+                    ActiveTritsSet activeTritsSet(bareState.firstActiveTritsAllowed);
+                    N_TrailCore_Iterator it(activeTritsSet, mixedCache, costFTrits, maxCost, true);
+                    for (; !it.isEnd(); ++it)
+                        nodes++;
+                }
+                return nodes;
+            };
+            BareStateIterator it(colSet, bareStateCache, costFBareState, maxCost, true);
+            calibration = calibrate(it, calibrationSeconds, visitNested);
+        }
+    }
+    estimate.secondsPerNode = calibration.secondsPerNode;
+    printEstimate(estimate, calibration);
+    if (check) {
+        if (!calibration.complete || tree[0] == "N") {
+            cerr << "--check needs a tree without nested trees, traversed during the calibration." << endl;
+            return 2;
+        }
+        double margin = 1.96 * estimate.nodesStdError;
+        if (calibration.nodes < estimate.nodes - margin || calibration.nodes > estimate.nodes + margin) {
+            cerr << "The exact number of nodes is outside the confidence interval." << endl;
+            return 1;
+        }
+    }
+    return 0;
+}
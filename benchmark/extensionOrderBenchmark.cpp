@@ -0,0 +1,107 @@
+/* extensionOrderBenchmark.cpp */
+
+/*
+Comparison of the orders in which the extension iterators choose the parts of
+an extension (see ExtensionPartsOrder in extensionsIterator.h). Each trail core
+of a file is extended by one round, forward or backward, with each order, and
+the number of nodes of the trees visited, the number of extensions found and
+the time are printed. The extensions found must not depend on the order.
+
+Build and run from the root of the repository, eg:
+    g++ -std=c++17 -O2 -pthread -I. benchmark/extensionOrderBenchmark.cpp \
+        $(ls *.cpp | grep -v main.cpp) -o extensionOrderBenchmark
+    ./extensionOrderBenchmark forward|backward <maxTotalWeight> <trail core file>
+The maximum weight of an extension is computed as in extendTrailCore, ie
+maxTotalWeight minus the weight of the trail core without its wMinDir (forward)
+or wMinRev (backward). For instance, the forward extensions of the NN and KN
+searches are benchmarked with the 3-round trail cores they extend.
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include "backwardExtension.h"
+#include "forwardExtension.h"
+#include "trailCore.h"
+
+typedef chrono::steady_clock Clock;
+
+/** The totals of the extensions of all the trail cores of a file. */
+class OrderResult {
+    public:
+        UINT64 nodes;
+        UINT64 extensions;
+        double seconds;
+    public:
+        OrderResult(): nodes(0), extensions(0), seconds(0) {}
+};
+
+template<class Preparation, class Iterator>
+void extend(const TroikaState& state, WeightBound maxWeightExtension, OrderResult& result)
+{
+    Preparation prep(state, maxWeightExtension);
+    Iterator extensions(prep, state);
+    for (; !extensions.isEnd(); ++extensions)
+        result.extensions++;
+    result.nodes += extensions.nrNodes;
+}
+
+OrderResult run(bool backward, long double maxTotalWeight, const string& fileName,
+                ExtensionPartsOrder order)
+{
+    ForwardExtensionPreparation::partsOrder = order;
+    BackwardExtensionPreparation::partsOrder = order;
+    OrderResult result;
+    Clock::time_point start = Clock::now();
+    for (TrailFileIterator trails(fileName); !trails.isEnd(); ++trails) {
+        const TrailCore& trailCore = *trails;
+        if (backward) {
+            WeightBound maxWeightExtension = WeightBound(maxTotalWeight)
+                                             - (trailCore.weight - trailCore.wMinRev);
+            extend<BackwardExtensionPreparation, BackwardExtensionIterator>(
+                trailCore.differences[0], maxWeightExtension, result);
+        } else {
+            WeightBound maxWeightExtension = WeightBound(maxTotalWeight)
+                                             - (trailCore.weight - trailCore.wMinDir);
+            extend<ForwardExtensionPreparation, ForwardExtensionIterator>(
+                trailCore.differences.back(), maxWeightExtension, result);
+        }
+    }
+    result.seconds = chrono::duration<double>(Clock::now() - start).count();
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 4) {
+        cerr << "usage: " << argv[0] << " forward|backward <maxTotalWeight> <trail core file>" << endl;
+        return 1;
+    }
+    bool backward = (string(argv[1]) == "backward");
+    long double maxTotalWeight = atof(argv[2]);
+    string fileName = argv[3];
+
+    const ExtensionPartsOrder orders[] = {slicePartsOrder,
+                                          fewestValuesFirstPartsOrder,
+                                          closingSlicesFirstPartsOrder};
+    const char* names[] = {"slice", "fewest values first", "closing slices first"};
+    try {
+        OrderResult reference;
+        cout << "order,nodes,extensions,seconds" << endl;
+        for (unsigned int i = 0; i < 3; i++) {
+            OrderResult result = run(backward, maxTotalWeight, fileName, orders[i]);
+            cout << names[i] << "," << dec << result.nodes << "," << result.extensions;
+            cout << "," << result.seconds << endl;
+            if (i == 0)
+                reference = result;
+            else if (result.extensions != reference.extensions) {
+                cerr << "The number of extensions depends on the order." << endl;
+                return 1;
+            }
+        }
+    }
+    catch (Exception e) {
+        cerr << e.reason << endl;
+        return 1;
+    }
+    return 0;
+}
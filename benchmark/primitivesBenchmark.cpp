@@ -0,0 +1,222 @@
+/* primitivesBenchmark.cpp */
+
+/*
+Microbenchmarks of the primitives used in the innermost loops of the trail
+search: the linear layer on Troika states, the tryte accessors, the
+canonical representative of an active state, the SubTrytes compatibility
+test and the storage of trail cores.
+
+The inputs are low-weight trail cores found by the KK, NN and extension
+searches (T3 = 27). Before timing, it checks that the trail cores of 2 to
+16 rounds are read back as saved, in both storage formats, and exits with 1
+otherwise.
+
+Build and run from the root of the repository, eg:
+    g++ -std=c++17 -O2 -pthread -I. benchmark/primitivesBenchmark.cpp \
+        $(ls *.cpp | grep -v main.cpp) -o primitivesBenchmark
+    ./primitivesBenchmark [repetitions] [iterations]
+*/
+
+#include <cstdlib>
+#include <sstream>
+#include "benchmark.h"
+#include "sbox.h"
+#include "state.h"
+#include "trailCore.h"
+
+/** Trail cores saved by real runs, in the format of TrailCore::save(). */
+static const char* savedTrailCores[] = {
+    "3 8 0 a 0 8 0 0 0 4000 0 0 0 0 0 2000000 0 0 0 0 0 0 0 0 0 0 0 0 "
+    "0 0 0 0 0 0 0 0 0 0 0 0 1 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 4000 "
+    "0 0 0 0 1 0 0 0 0 0 400000 0 0 0 0 0 0 0 0 0 0 0 0 1 0 0 0 0 0 0 "
+    "0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 400000 0 0 0 0 0 0 0 0 0 0 0 0 "
+    "1 0 400000 0 0 0 0 0 0 0 0 0 0 0 0 1 0 0 0 0 0 0 0 0 0 0 0 0 0 0 "
+    "0 0 0 0 0 0 0 0 0 0 0 0 0 400000 0 0 0 0 0 0 0 0 0 0 200000 0 20 "
+    "0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 20 0 0 0 0 0 0 0 0 0 0 0 0 0 "
+    "0 0 200000 0 0 0 0 0 0 0 0 0 0 0 0 ",
+    "3 8 0 a 0 8 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 800 0 0 0 0 0 0 4000000 "
+    "0 0 0 0 0 1000000 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 "
+    "80000 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 100000 0 0 0 0 0 0 0 0 0 "
+    "0 0 0 1 0 0 0 0 0 100000 0 0 0 0 0 0 0 0 0 0 1 0 0 0 0 0 0 0 0 0 "
+    "0 0 0 0 0 0 0 0 0 0 0 0 100000 0 0 0 0 0 0 0 0 0 0 0 0 1 0 0 0 0 "
+    "0 0 0 0 100000 0 0 0 0 0 0 0 0 0 0 0 0 1 0 0 0 0 0 0 0 0 0 0 0 0 "
+    "0 0 0 0 0 0 400000 0 0 0 0 0 0 0 0 0 4000000 0 0 0 0 0 0 0 0 "
+    "400000 0 0 0 0 0 0 0 0 0 4000000 0 0 0 0 0 0 0 0 0 0 0 0 ",
+    "3 c 0 2 0 c 0 0 0 0 0 0 0 0 0 0 0 0 0 20 0 0 4000000 20 0 0 0 0 0 "
+    "0 0 1000 0 0 0 8000 0 0 0 0 0 0 0 40000 0 0 0 10 0 0 0 0 0 0 0 0 "
+    "0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 100 0 0 0 0 0 0 0 0 0 0 0 "
+    "0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 "
+    "0 0 0 0 0 0 0 100 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 "
+    "0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 200 0 400 0 "
+    "400 0 0 0 0 0 0 0 0 0 0 0 0 0 200 0 0 0 400 0 0 0 0 0 0 0 0 0 0 0 "
+    "0 0 200 0 0 0 400 0 0 ",
+    "3 c 0 2 0 c 0 0 0 0 0 0 0 0 0 0 0 0 0 0 20 0 0 0 20 0 0 0 0 0 0 0 "
+    "1000 0 0 0 8000 0 0 0 0 0 0 0 40000 1000000 0 0 10 0 0 0 0 0 0 0 "
+    "0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 "
+    "0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 100 0 0 0 0 0 0 0 0 0 "
+    "0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 "
+    "0 0 0 0 0 0 0 0 0 100 0 0 0 0 0 0 0 0 0 80000 0 0 0 100000 0 0 0 "
+    "0 0 0 0 0 0 0 0 0 0 80000 0 0 0 100000 0 0 0 0 0 0 0 0 0 0 0 0 0 "
+    "80000 0 100000 0 100000 0 0 0 0 0 0 0 0 0 ",
+    "4 8 0 a 0 8 0 2a 0 0 0 4000 0 0 0 0 0 2000000 0 0 0 0 0 0 0 0 0 0 "
+    "0 0 0 0 0 0 0 0 0 0 0 0 0 0 1 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 "
+    "4000 0 0 0 0 1 0 0 0 0 0 400000 0 0 0 0 0 0 0 0 0 0 0 0 1 0 0 0 0 "
+    "0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 400000 0 0 0 0 0 0 0 0 0 0 "
+    "0 0 1 0 400000 0 0 0 0 0 0 0 0 0 0 0 0 1 0 0 0 0 0 0 0 0 0 0 0 0 "
+    "0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 400000 0 0 0 0 0 0 0 0 0 0 200000 0 "
+    "20 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 20 0 0 0 0 0 0 0 0 0 0 0 0 "
+    "0 0 0 200000 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 200000 0 0 0 20 0 0 "
+    "0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 20 0 20 0 0 0 0 0 0 0 0 0 0 0 0 "
+    "200000 0 0 0 0 0 0 0 0 0 0 0 0 0 0 4000 0 8000 0 8002 0 4 0 4 0 1 "
+    "0 0 0 2 0 0 0 4000 0 0 0 8002 0 0 0 4 0 1 0 2 0 2000002 0 0 0 "
+    "4000 0 0 0 8002 0 0 0 4 0 1 0 0 0 2 2000000 "
+};
+
+/** It checks that a trail core of @a nrRounds rounds built from @a states 
+  * is read back by TrailCore::load() as it was saved, in both storage 
+  * formats. From 12 rounds on, the line of the full format starts with a 
+  * hexadecimal digit that is also a letter. 
+  */
+static bool checkStorage(const vector<TroikaState>& states, unsigned int nrRounds)
+{
+    vector<TroikaState> differences;
+    vector<Weight> weights;
+    for (unsigned int i = 0; i < nrRounds - 1; i++) {
+        differences.push_back(states[i % states.size()]);
+        differences.push_back(differences.back());
+        differences.back().L();
+        if (i > 0)
+            weights.push_back(Weight(2 * i));
+    }
+    TrailCore trail(differences, Weight(2), Weight(4), weights);
+    bool compactStorage = TrailCore::compactStorage;
+    bool ok = true;
+    for (unsigned int compact = 0; compact < 2; compact++) {
+        TrailCore::compactStorage = (compact == 1);
+        ostringstream sout;
+        trail.save(sout);
+        try {
+            istringstream sin(sout.str());
+            TrailCore loaded(sin);
+            ostringstream soutLoaded;
+            loaded.save(soutLoaded);
+            ok = ok && (loaded.nrRounds == nrRounds) && (soutLoaded.str() == sout.str());
+        } catch (Exception e) {
+            ok = false;
+        }
+    }
+    TrailCore::compactStorage = compactStorage;
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int repetitions = (argc > 1) ? atoi(argv[1]) : 21;
+    unsigned int iterations  = (argc > 2) ? atoi(argv[2]) : 100000;
+
+    vector<TrailCore> trails;
+    vector<TroikaState> states;
+    for (unsigned int i = 0; i < sizeof(savedTrailCores) / sizeof(savedTrailCores[0]); i++) {
+        istringstream sin(savedTrailCores[i]);
+        trails.push_back(TrailCore(sin));
+        for (unsigned int j = 0; j < trails.back().differences.size(); j++)
+            states.push_back(trails.back().differences[j]);
+    }
+    // pairs (b_i, a_{i+1}) around SubTrytes
+    vector<TroikaState> beforeST, afterST;
+    for (unsigned int i = 0; i < trails.size(); i++) {
+        for (unsigned int j = 1; j + 1 < trails[i].differences.size(); j += 2) {
+            beforeST.push_back(trails[i].differences[j]);
+            afterST.push_back(trails[i].differences[j + 1]);
+        }
+    }
+    vector<ActiveState> activeStates;
+    for (unsigned int i = 0; i < states.size(); i++)
+        activeStates.push_back(ActiveState(states[i]));
+    vector<string> savedLines;
+    for (unsigned int i = 0; i < trails.size(); i++) {
+        ostringstream sout;
+        trails[i].save(sout);
+        savedLines.push_back(sout.str());
+    }
+    for (unsigned int nrRounds = 2; nrRounds <= 16; nrRounds++) {
+        if (!checkStorage(states, nrRounds)) {
+            cerr << "The trail cores of " << dec << nrRounds << " rounds are not read back as saved." << endl;
+            return 1;
+        }
+    }
+    Sbox sbox;
+
+    vector<BenchmarkResult> results;
+    const unsigned int nrStates = states.size();
+
+    results.push_back(runBenchmark("TroikaState::copy", [&](unsigned int i) {
+        TroikaState state = states[i % nrStates];
+        benchmarkSink = state.lanes[i % 27].lane_1;
+    }, iterations, repetitions));
+    results.push_back(runBenchmark("TroikaState::SRSL", [&](unsigned int i) {
+        TroikaState state = states[i % nrStates];
+        state.SRSL();
+        benchmarkSink = state.lanes[i % 27].lane_1;
+    }, iterations, repetitions));
+    results.push_back(runBenchmark("TroikaState::invSRSL", [&](unsigned int i) {
+        TroikaState state = states[i % nrStates];
+        state.invSRSL();
+        benchmarkSink = state.lanes[i % 27].lane_1;
+    }, iterations, repetitions));
+    results.push_back(runBenchmark("TroikaState::addColumnParity", [&](unsigned int i) {
+        TroikaState state = states[i % nrStates];
+        state.addColumnParity();
+        benchmarkSink = state.lanes[i % 27].lane_1;
+    }, iterations, repetitions));
+    results.push_back(runBenchmark("TroikaState::L", [&](unsigned int i) {
+        TroikaState state = states[i % nrStates];
+        state.L();
+        benchmarkSink = state.lanes[i % 27].lane_1;
+    }, iterations, repetitions));
+    results.push_back(runBenchmark("TroikaState::invL", [&](unsigned int i) {
+        TroikaState state = states[i % nrStates];
+        state.invL();
+        benchmarkSink = state.lanes[i % 27].lane_1;
+    }, iterations, repetitions));
+    results.push_back(runBenchmark("TroikaState::getTryte", [&](unsigned int i) {
+        const TroikaState& state = states[i % nrStates];
+        unsigned int sum = 0;
+        for (unsigned int z = 0; z < SLICES; z++)
+            for (unsigned int y = 0; y < ROWS; y++)
+                for (unsigned int xTryte = 0; xTryte < 3; xTryte++)
+                    sum += state.getTryte(xTryte, y, z).value;
+        benchmarkSink = sum;
+    }, iterations / 10, repetitions));
+    results.push_back(runBenchmark("TroikaState::getNrActiveTrytes", [&](unsigned int i) {
+        benchmarkSink = states[i % nrStates].getNrActiveTrytes();
+    }, iterations, repetitions));
+    results.push_back(runBenchmark("TroikaState::isInKernel", [&](unsigned int i) {
+        benchmarkSink = states[i % nrStates].isInKernel();
+    }, iterations, repetitions));
+    results.push_back(runBenchmark("ActiveState::setTheBiggestRepresentative", [&](unsigned int i) {
+        ActiveState biggest;
+        activeStates[i % nrStates].setTheBiggestRepresentative(biggest);
+        benchmarkSink = biggest.getNrActiveTrytes();
+    }, iterations / 10, repetitions));
+    results.push_back(runBenchmark("Sbox::areSTCompatible", [&](unsigned int i) {
+        Weight weight;
+        unsigned int k = i % beforeST.size();
+        benchmarkSink = sbox.areSTCompatible(beforeST[k], afterST[k], weight) + weight.integer;
+    }, iterations, repetitions));
+    results.push_back(runBenchmark("TrailCore::save", [&](unsigned int i) {
+        ostringstream sout;
+        trails[i % trails.size()].save(sout);
+        benchmarkSink = sout.tellp();
+    }, iterations / 10, repetitions));
+    results.push_back(runBenchmark("TrailCore::load", [&](unsigned int i) {
+        istringstream sin(savedLines[i % savedLines.size()]);
+        TrailCore trail(sin);
+        benchmarkSink = trail.nrRounds;
+    }, iterations / 10, repetitions));
+
+    BenchmarkResult::printHeader(cout);
+    for (unsigned int i = 0; i < results.size(); i++)
+        results[i].print(cout);
+    return 0;
+}
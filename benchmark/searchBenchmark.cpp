@@ -0,0 +1,297 @@
+/* searchBenchmark.cpp */
+
+/*
+End-to-end benchmark of the generation of the 3-round trail cores: it runs
+the KK, KN, NK and NN searches for small bounds T3, reports the wall time and
+the number of trail cores found for each profile, and checks the number of
+trail cores per weight against the golden reports of benchmark/golden.
+
+A golden report is the report written by produceHumanReadableFile for the
+final file of the profile (eg NN-27-verif.txt), without the execution time.
+The KN and NK profiles also have the golden report <profile>-K.txt of the
+2-round trail cores in the kernel that they extend. It is checked even when
+no 3-round trail core is found.
+The executable returns 1 if a report does not match its golden report, so an
+optimization of the traversals or of the extension iterators can be checked
+with a single command.
+
+Build and run from the root of the repository, eg:
+    g++ -std=c++17 -O2 -pthread -I. benchmark/searchBenchmark.cpp \
+        $(ls *.cpp | grep -v main.cpp) -o searchBenchmark
+    ./searchBenchmark [--update] [--golden dir] [--run dir] [profile ...]
+where a profile is KK-<T3>, KN-<T3>-<T1>, NK-<T3>-<T1> or NN-<T3>. By
+default, the KK searches are run for 24 ≤ T3 ≤ 31, the NN searches for
+24 ≤ T3 ≤ 27, and the KN and NK searches for (T3, T1) = (27, 7) and up to
+the first T3 with trail cores, ie (29, 9) for KN and (31, 9) for NK. Below
+24, no search finds a trail core. With --update, the golden reports are
+overwritten by the reports of the run.
+
+The generated files are written in the run directory (by default
+benchmark-run). The results are printed as CSV lines
+    profile,T3,T1,wall_ms,trails,nodes,golden
+where nodes is the number of nodes visited by the tree iterators. It is only
+known if the code is compiled with -DTRAVERSAL_STATISTICS (see traversal.h),
+otherwise the field is empty.
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <dirent.h>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "3RoundsTrailCores.h"
+#include "KK_trailCores.h"
+#include "trailCore.h"
+
+/** A search to run. */
+class SearchProfile {
+    public:
+        /** KK, KN, NK or NN. */
+        string kind;
+        int T3;
+        /** Only used by the KN and NK searches. */
+        int T1;
+    public:
+        SearchProfile(const string& aKind, int aT3, int aT1 = 0):
+            kind(aKind), T3(aT3), T1(aT1) {}
+        /** It parses a profile of the form KK-27, KN-27-7, NK-27-7 or NN-27. */
+        SearchProfile(const string& profile): T3(0), T1(0)
+        {
+            char separator;
+            istringstream sin(profile);
+            kind = profile.substr(0, 2);
+            sin.ignore(2);
+            sin >> separator >> T3;
+            if (kind == "KN" || kind == "NK")
+                sin >> separator >> T1;
+            if (sin.fail() || (kind != "KK" && kind != "KN" && kind != "NK" && kind != "NN"))
+                throw Exception("Unknown profile '" + profile + "'.");
+        }
+        string getName() const
+        {
+            stringstream name;
+            name << kind << "-" << T3;
+            if (kind == "KN" || kind == "NK")
+                name << "-" << T1;
+            return name.str();
+        }
+        /** It returns the name of the file that contains the trail cores found. */
+        string getTrailFileName() const
+        {
+            stringstream name;
+            if (kind == "KK")
+                name << "KK-trailCores-T3-" << T3;
+            else
+                name << kind << "-" << T3 << "-verif";
+            return name.str();
+        }
+        /** It returns the name of the file of the 2-round trail cores in the 
+          * kernel extended by a KN or NK search, and an empty string for the
+          * other searches. 
+          */
+        string get_K_TrailFileName() const
+        {
+            stringstream name;
+            if (kind == "KN")
+                name << "K-trailCores-T1-" << T1 << "-alpha-1-beta-0";
+            else if (kind == "NK")
+                name << "K-trailCores-T1-" << T1 << "-alpha-0-beta-1";
+            return name.str();
+        }
+        /** It runs the search in the current directory. */
+        void run() const
+        {
+            if (kind == "KK") {
+                KK_TrailCores KK(T3);
+                KK.generate_KK_trailCores();
+            } else if (kind == "KN") {
+                KN_TrailCores KN(T3, T1);
+                KN.K_TrailCores();
+                KN.KN_FromForwardExtension();
+                KN.KN_FromInKernelExtension();
+                KN.nrTrailsFound();
+            } else if (kind == "NK") {
+                NK_TrailCores NK(T3, T1);
+                NK.K_TrailCores();
+                NK.NK_FromBackwardExtension();
+                NK.NK_FromInKernelExtension();
+                NK.nrTrailsFound();
+            } else {
+                NN_TrailCores NN(T3);
+                NN.NN_FromBackwardExtension();
+                NN.NN_FromForwardExtension();
+                NN.nrTrailsFound();
+            }
+        }
+};
+
+/** It returns the lines of a report, except the execution time. */
+vector<string> readReport(const string& fileName)
+{
+    vector<string> lines;
+    ifstream fin(fileName.c_str());
+    string line;
+    while (getline(fin, line)) {
+        if (line.compare(0, 14, "Execution time") != 0)
+            lines.push_back(line);
+    }
+    return lines;
+}
+
+void writeReport(const string& fileName, const vector<string>& lines)
+{
+    ofstream fout(fileName.c_str());
+    for (unsigned int i = 0; i < lines.size(); i++)
+        fout << lines[i] << endl;
+}
+
+unsigned int countTrails(const string& fileName)
+{
+    unsigned int count = 0;
+    TrailFileIterator trails(fileName);
+    for (; !trails.isEnd(); ++trails)
+        count++;
+    return count;
+}
+
+/** It returns the names of the statistics files of the current directory. */
+vector<string> getStatisticsFileNames()
+{
+    const string suffix = "-statistics.json";
+    vector<string> fileNames;
+    DIR* directory = opendir(".");
+    if (directory == NULL)
+        return fileNames;
+    struct dirent* entry;
+    while ((entry = readdir(directory)) != NULL) {
+        string fileName = entry->d_name;
+        if (fileName.size() > suffix.size()
+            && fileName.compare(fileName.size() - suffix.size(), suffix.size(), suffix) == 0)
+            fileNames.push_back(fileName);
+    }
+    closedir(directory);
+    return fileNames;
+}
+
+/** It returns the sum of the "nodes" arrays of the statistics files written
+  * by saveTraversalStatistics, or -1 if there is no such file.
+  */
+long long countNodes(const vector<string>& fileNames)
+{
+    if (fileNames.empty())
+        return -1;
+    long long count = 0;
+    for (unsigned int i = 0; i < fileNames.size(); i++) {
+        ifstream fin(fileNames[i].c_str());
+        string content((istreambuf_iterator<char>(fin)), istreambuf_iterator<char>());
+        size_t position = 0;
+        while ((position = content.find("\"nodes\": [", position)) != string::npos) {
+            istringstream sin(content.substr(position + 10, content.find(']', position) - position - 10));
+            long long value;
+            char separator;
+            while (sin >> value) {
+                count += value;
+                sin >> separator;
+            }
+            position++;
+        }
+    }
+    return count;
+}
+
+string absolutePath(const string& path)
+{
+    if (!path.empty() && path[0] == '/')
+        return path;
+    char buffer[4096];
+    if (getcwd(buffer, sizeof(buffer)) == NULL)
+        throw Exception("The current directory cannot be read.");
+    return string(buffer) + "/" + path;
+}
+
+int main(int argc, char** argv)
+{
+    bool update = false;
+    string goldenDirectory = "benchmark/golden";
+    string runDirectory = "benchmark-run";
+    vector<SearchProfile> profiles;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            string argument = argv[i];
+            if (argument == "--update")
+                update = true;
+            else if (argument == "--golden" && i + 1 < argc)
+                goldenDirectory = argv[++i];
+            else if (argument == "--run" && i + 1 < argc)
+                runDirectory = argv[++i];
+            else
+                profiles.push_back(SearchProfile(argument));
+        }
+        if (profiles.empty()) {
+            for (int T3 = 24; T3 <= 31; T3++)
+                profiles.push_back(SearchProfile("KK", T3));
+            profiles.push_back(SearchProfile("KN", 27, 7));
+            profiles.push_back(SearchProfile("KN", 29, 9));
+            profiles.push_back(SearchProfile("NK", 27, 7));
+            profiles.push_back(SearchProfile("NK", 31, 9));
+            for (int T3 = 24; T3 <= 27; T3++)
+                profiles.push_back(SearchProfile("NN", T3));
+        }
+        goldenDirectory = absolutePath(goldenDirectory);
+        mkdir(runDirectory.c_str(), 0755);
+        if (chdir(runDirectory.c_str()) != 0)
+            throw Exception("The directory '" + runDirectory + "' cannot be used.");
+    } catch (Exception e) {
+        cerr << e.reason << endl;
+        return 2;
+    }
+
+    // the searches write their progress on cout
+    ostringstream csv;
+    csv << "profile,T3,T1,wall_ms,trails,nodes,golden" << endl;
+    bool mismatch = false;
+    for (unsigned int i = 0; i < profiles.size(); i++) {
+        const SearchProfile& profile = profiles[i];
+        vector<string> statisticsFileNames = getStatisticsFileNames();
+        for (unsigned int j = 0; j < statisticsFileNames.size(); j++)
+            remove(statisticsFileNames[j].c_str());
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        profile.run();
+        chrono::steady_clock::time_point ending = chrono::steady_clock::now();
+        double wallTime = chrono::duration<double, milli>(ending - start).count();
+
+        string trailFileName = profile.getTrailFileName();
+        // the reports to check, and the names of their golden reports
+        vector<pair<string, string> > reports;
+        reports.push_back(make_pair(trailFileName, profile.getName()));
+        if (!profile.get_K_TrailFileName().empty())
+            reports.push_back(make_pair(profile.get_K_TrailFileName(), profile.getName() + "-K"));
+        string status = update ? "updated" : "ok";
+        for (unsigned int j = 0; j < reports.size(); j++) {
+            vector<string> report = readReport(reports[j].first + ".txt");
+            string goldenFileName = goldenDirectory + "/" + reports[j].second + ".txt";
+            if (update) {
+                writeReport(goldenFileName, report);
+            } else if (!ifstream(goldenFileName.c_str())) {
+                status = "missing";
+                mismatch = true;
+            } else if (readReport(goldenFileName) != report) {
+                if (status == "ok")
+                    status = "mismatch";
+                mismatch = true;
+            }
+        }
+        csv << profile.getName() << "," << dec << profile.T3 << "," << profile.T1 << ",";
+        csv << wallTime << "," << countTrails(trailFileName) << ",";
+        long long nodes = countNodes(getStatisticsFileNames());
+        if (nodes >= 0)
+            csv << nodes;
+        csv << "," << status << endl;
+    }
+    cout << csv.str();
+    return mismatch ? 1 : 0;
+}
@@ -0,0 +1,159 @@
+/* extensionCache.cpp */
+#include "extensionCache.h"
+
+size_t ExtensionCache::defaultCapacity = 100000;
+
+ExtensionCache::ExtensionCache(size_t aCapacity)
+: capacity(aCapacity), size(0), nrHits(0), nrMisses(0)
+{
+}
+
+void ExtensionCache::getForwardExtensions(const TroikaState& stateB,
+                                          WeightBound maxWeightExtension,
+                                          vector<ForwardExtension>& extensions)
+{
+    extensions.clear();
+    unsigned int dz;
+    CachedExtensionList uncached;
+    const CachedExtensionList* cached = find(false, stateB, maxWeightExtension, dz, uncached);
+
+    // The extensions are complete, so the positions of the active trytes of
+    // B, only used to compute the compatibility through SubTrytes, are left
+    // empty instead of being copied in each extension. 
+    const vector<TrytePosition> noPositions;
+    extensions.reserve(cached->size());
+    CachedExtensionList::const_iterator it;
+    for (it = cached->begin(); it != cached->end(); ++it) {
+        if (it->getWeight() <= maxWeightExtension) {
+            ForwardExtension extension(stateB, noPositions);
+            extension.stateC = it->first;
+            extension.stateC.translate(dz);
+            extension.stateD = it->second;
+            extension.stateD.translate(dz);
+            extension.wBC = it->wBC;
+            extension.wMinDirD = it->wMin;
+            extension.valid = true;
+            extensions.push_back(extension);
+        }
+    }
+}
+
+void ExtensionCache::getBackwardExtensions(const TroikaState& stateC,
+                                           WeightBound maxWeightExtension,
+                                           vector<BackwardExtension>& extensions)
+{
+    extensions.clear();
+    unsigned int dz;
+    CachedExtensionList uncached;
+    const CachedExtensionList* cached = find(true, stateC, maxWeightExtension, dz, uncached);
+    extensions.reserve(cached->size());
+
+    CachedExtensionList::const_iterator it;
+    for (it = cached->begin(); it != cached->end(); ++it) {
+        if (it->getWeight() <= maxWeightExtension) {
+            BackwardExtension extension;
+            extension.stateA = it->first;
+            extension.stateA.translate(dz);
+            extension.stateB = it->second;
+            extension.stateB.translate(dz);
+            extension.wBC = it->wBC;
+            extension.wMinRevA = it->wMin;
+            extensions.push_back(extension);
+        }
+    }
+}
+
+const CachedExtensionList* ExtensionCache::find(bool backward, const TroikaState& state,
+                                                WeightBound maxWeightExtension, unsigned int& dz,
+                                                CachedExtensionList& uncached)
+{
+    TroikaState canonical(state);
+    unsigned int dzMin = 0;
+    for (unsigned int dzCurrent = 1; dzCurrent < SLICES; dzCurrent++) {
+        TroikaState current(state);
+        current.translate(dzCurrent);
+        if (current < canonical) {
+            canonical = current;
+            dzMin = dzCurrent;
+        }
+    }
+    dz = (SLICES - dzMin) % SLICES;
+
+    Key key(backward, canonical);
+    map<Key, Entry>::iterator entry = entries.find(key);
+    if ((entry != entries.end()) && !(entry->second.maxWeightExtension < maxWeightExtension)) {
+        nrHits++;
+        recentlyUsedKeys.splice(recentlyUsedKeys.begin(), recentlyUsedKeys,
+                                entry->second.recentlyUsed);
+        return &entry->second.extensions;
+    }
+    nrMisses++;
+    if (entry != entries.end())
+        erase(entry);
+
+    CachedExtensionList computed;
+    if (backward)
+        computeBackwardExtensions(canonical, maxWeightExtension, computed);
+    else
+        computeForwardExtensions(canonical, maxWeightExtension, computed);
+    if (computed.size() + 1 > capacity) {
+        uncached.swap(computed);
+        return &uncached;
+    }
+    while (size + computed.size() + 1 > capacity)
+        erase(entries.find(recentlyUsedKeys.back()));
+    recentlyUsedKeys.push_front(key);
+    Entry& newEntry = entries[key];
+    newEntry.maxWeightExtension = maxWeightExtension;
+    newEntry.extensions.swap(computed);
+    newEntry.recentlyUsed = recentlyUsedKeys.begin();
+    size += newEntry.extensions.size() + 1;
+    return &newEntry.extensions;
+}
+
+void ExtensionCache::computeForwardExtensions(const TroikaState& stateB,
+                                              WeightBound maxWeightExtension,
+                                              CachedExtensionList& extensions)
+{
+    ForwardExtensionPreparation prep(stateB, maxWeightExtension);
+    ForwardExtensionIterator it(prep, stateB);
+    for (; !it.isEnd(); ++it) {
+        CachedExtension extension;
+        extension.first = (*it).stateC;
+        extension.second = (*it).stateD;
+        extension.wBC = (*it).wBC;
+        extension.wMin = (*it).wMinDirD;
+        extensions.push_back(extension);
+    }
+}
+
+void ExtensionCache::computeBackwardExtensions(const TroikaState& stateC,
+                                               WeightBound maxWeightExtension,
+                                               CachedExtensionList& extensions)
+{
+    BackwardExtensionPreparation prep(stateC, maxWeightExtension);
+    BackwardExtensionIterator it(prep, stateC);
+    for (; !it.isEnd(); ++it) {
+        CachedExtension extension;
+        extension.first = (*it).stateA;
+        extension.second = (*it).stateB;
+        extension.wBC = (*it).wBC;
+        extension.wMin = (*it).wMinRevA;
+        extensions.push_back(extension);
+    }
+}
+
+void ExtensionCache::erase(map<Key, Entry>::iterator entry)
+{
+    size -= entry->second.extensions.size() + 1;
+    recentlyUsedKeys.erase(entry->second.recentlyUsed);
+    entries.erase(entry);
+}
+
+ostream& operator<<(ostream& fout, const ExtensionCache& cache)
+{
+    fout << "extension cache: " << dec << cache.nrHits << " hits, " << cache.nrMisses;
+    fout << " misses, " << cache.entries.size() << " states, " << cache.size - cache.entries.size();
+    fout << " extensions stored" << endl;
+    return fout;
+}
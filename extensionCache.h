@@ -0,0 +1,113 @@
+/* extensionCache.h */
+#ifndef EXTENSION_CACHE_H
+#define EXTENSION_CACHE_H
+
+/*
+The class of this file memoizes the extensions of the boundary states of the
+trail cores: the forward extensions of a state B and the backward extensions
+of a state C. Many trail cores to extend share their boundary state up to a
+translation along the z axis, and the extensions of a state are the
+translations of the extensions of its canonical representative. The cache
+therefore keeps the extensions of the canonical representatives, together
+with the maximum weight they were computed for, and translates them back to
+the position of the state asked for. A list computed for a maximum weight
+also answers the queries with a lower maximum weight, by filtering.
+
+The cache holds at most a given number of extensions. When it is full, the
+states used least recently are removed first.
+*/
+
+#include <list>
+#include <map>
+#include "backwardExtension.h"
+#include "forwardExtension.h"
+#include "memoryAccounting.h"
+
+/** The states and weights of a cached extension. For a forward extension of
+  * B, they are C, D, w(B--ST-->C) and wMinDir(D); for a backward extension of
+  * C, they are A, B, w(B--ST-->C) and wMinRev(A).
+  */
+class CachedExtension {
+    public:
+        TroikaState first;
+        TroikaState second;
+        Weight wBC;
+        Weight wMin;
+    public:
+        Weight getWeight() const { return wBC + wMin; }
+};
+
+typedef vector<CachedExtension, AccountedAllocator<CachedExtension, memoryExtensionCache> >
+    CachedExtensionList;
+
+class ExtensionCache {
+    protected:
+        /** The key of an entry: true for the backward extensions, and the
+          * canonical representative of the boundary state.
+          */
+        typedef pair<bool, TroikaState> Key;
+        class Entry {
+            public:
+                /** The maximum weight of the extensions of the list. */
+                WeightBound maxWeightExtension;
+                /** All the extensions of the canonical state up to
+                  * maxWeightExtension.
+                  */
+                CachedExtensionList extensions;
+                /** The position of the key in the list of the recently used keys. */
+                list<Key>::iterator recentlyUsed;
+        };
+        /** The maximum number of extensions stored, where each entry counts
+          * as one more extension. 
+          */
+        size_t capacity;
+        /** The number of extensions stored, plus the number of entries. */
+        size_t size;
+        map<Key, Entry> entries;
+        /** The keys, from the most recently used to the least recently used. */
+        list<Key> recentlyUsedKeys;
+        UINT64 nrHits;
+        UINT64 nrMisses;
+    public:
+        /** The capacity of the caches built with the default constructor. */
+        static size_t defaultCapacity;
+    public:
+        /** The constructor.
+          * @param aCapacity    The maximum number of extensions stored.
+          */
+        ExtensionCache(size_t aCapacity = defaultCapacity);
+        /** It sets in @a extensions the forward extensions of @a stateB of
+          * weight (w(B--ST-->C) + wMinDir(D)) up to @a maxWeightExtension,
+          * as the ForwardExtensionIterator would produce them, except that
+          * their posForSTCompatibility is empty.
+          */
+        void getForwardExtensions(const TroikaState& stateB, WeightBound maxWeightExtension,
+                                  vector<ForwardExtension>& extensions);
+        /** It sets in @a extensions the backward extensions of @a stateC of
+          * weight (w(B--ST-->C) + wMinRev(A)) up to @a maxWeightExtension,
+          * as the BackwardExtensionIterator would produce them.
+          */
+        void getBackwardExtensions(const TroikaState& stateC, WeightBound maxWeightExtension,
+                                   vector<BackwardExtension>& extensions);
+        UINT64 getNrHits() const { return nrHits; }
+        UINT64 getNrMisses() const { return nrMisses; }
+        friend ostream& operator<<(ostream& fout, const ExtensionCache& cache);
+    protected:
+        /** It returns the extensions of the canonical representative of 
+          * @a state up to a maximum weight of at least @a maxWeightExtension,
+          * after computing them if needed. The list is valid until the next 
+          * call. If it is too big to be stored, it is set in @a uncached. 
+          * @param dz   Set to the translation from the canonical
+          *             representative back to @a state.
+          */
+        const CachedExtensionList* find(bool backward, const TroikaState& state,
+                                        WeightBound maxWeightExtension, unsigned int& dz,
+                                        CachedExtensionList& uncached);
+        void computeForwardExtensions(const TroikaState& stateB, WeightBound maxWeightExtension,
+                                      CachedExtensionList& extensions);
+        void computeBackwardExtensions(const TroikaState& stateC, WeightBound maxWeightExtension,
+                                       CachedExtensionList& extensions);
+        void erase(map<Key, Entry>::iterator entry);
+};
+
+#endif
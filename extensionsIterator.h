@@ -16,6 +16,26 @@ the kernel (see Appendix C).
 
 #include "state.h"
 
+/** The order in which the parts of an extension are chosen by the 
+  * GenericExtensionIterator. The costs of the extensions are computed slice 
+  * by slice, so the parts of a slice are always chosen together, and the 
+  * slices of a run of consecutive active slices are chosen in decreasing z. 
+  */ 
+enum ExtensionPartsOrder {
+    /** The parts of a slice in order of position (the original order). */
+    slicePartsOrder, 
+    /** In each slice, the parts with the fewest possible values first, so 
+      * that the branching of the tree happens as deep as possible. 
+      */ 
+    fewestValuesFirstPartsOrder, 
+    /** As fewestValuesFirstPartsOrder, and the shortest runs of consecutive 
+      * active slices first. The addColumnParity dependencies between 
+      * neighbouring slices are then closed, and the cost of the slices 
+      * computed, after as few parts as possible. 
+      */ 
+    closingSlicesFirstPartsOrder
+};
+
 
 template <class Preparation,
           class Parts,  
@@ -41,7 +61,11 @@ template <class Preparation,
         /** The output representation of the extension. */ 
         Extension out; 
         /** The maximum weight of the extension. */ 
-        long double maxWeightExtension;
+        WeightBound maxWeightExtension;
+        /** Only the extensions of weight strictly above are output. Since an
+          * extension weighs at least 2, the default 0 keeps them all. 
+          */ 
+        WeightBound minWeightExtension;
         /** Attribute that indicates whether the iterator has reached the end or not. */
         bool end;
         /** Index of the current part of the extension that has to be chosen. */ 
@@ -51,6 +75,8 @@ template <class Preparation,
           * that the extension is completely chosen.
           */ 
         int indLastPart;
+        /** The number of nodes of the tree visited so far. */ 
+        UINT64 nrNodes; 
     public:
     /** The constructor.
        * @param  prep   The preparation of the extension that computes all the 
@@ -67,7 +93,9 @@ template <class Preparation,
             out(prep, state),
             indCurPart(-1), 
             indLastPart(-1), 
-            maxWeightExtension(prep.maxWeightExtension)
+            nrNodes(0), 
+            maxWeightExtension(prep.maxWeightExtension),
+            minWeightExtension(prep.minWeightExtension)
         {
             end = ! prep.couldBeExtended();
             if (end == false) {
@@ -98,7 +126,8 @@ template <class Preparation,
                     }
                 } while (indCurPart != indLastPart); 
                 out.set(partsList, cache, costF);
-            } while (out.isValidAndBelowWeight(maxWeightExtension) == false);
+            } while (out.isValidAndBelowWeight(maxWeightExtension) == false
+                     || out.isAboveWeight(minWeightExtension) == false);
         }
 
         /** It returns a constant reference to the current extension. */
@@ -106,6 +135,19 @@ template <class Preparation,
         {
             return out; 
         }
+
+        /** It lowers the maximum weight of the extensions to 
+          * @a aMaxWeightExtension, if it is lower, eg when a better bound is 
+          * found during the iteration. The next extensions are pruned with 
+          * the new bound. 
+          */
+        void lowerMaxWeightExtension(WeightBound aMaxWeightExtension)
+        {
+            if (aMaxWeightExtension < maxWeightExtension) {
+                maxWeightExtension = aMaxWeightExtension; 
+                costF.maxWeightExtension = aMaxWeightExtension; 
+            }
+        }
     private:
         /** This functions depends on the way we want to prune the tree. 
           * It moves if possible to the next valid node of the tree.
@@ -124,6 +166,7 @@ template <class Preparation,
             indCurPart++; 
             partsList[indCurPart].setFirstValue(cache);
             cache.push(partsList[indCurPart]);
+            nrNodes++; 
             return true; 
         }
         /** It moves to the parent of the current node by removing the value of 
@@ -151,6 +194,7 @@ template <class Preparation,
                 return false; 
             }
             cache.push(partsList[indCurPart]); 
+            nrNodes++; 
             return true;           
         }
 };
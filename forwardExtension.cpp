@@ -1,4 +1,5 @@
 /* forwardExtension.cpp */ 
+#include <algorithm>
 #include "forwardExtension.h"
 #include "state.h"
 
@@ -69,12 +70,14 @@ ostream & operator << (ostream &fout, const TritInfo &aTritInfo)
     return fout;
 }
 
+ExtensionPartsOrder ForwardExtensionPreparation::partsOrder = slicePartsOrder; 
+
 ForwardExtensionPreparation::ForwardExtensionPreparation(const TroikaState& stateB, 
-                                                         long double maxWeightExtension)
+                                                         WeightBound maxWeightExtension)
 :maxWeightExtension(maxWeightExtension)
 {
     initPosForSTCompatibility(stateB);
-    initPossibleActiveTritsAtSRSLCAndConstraintForActiveTritsAtC(stateB);
+    initPossibleActiveTritsAtSRSLC();
     int z; 
     unsigned int zStart; 
 
@@ -86,12 +89,26 @@ ForwardExtensionPreparation::ForwardExtensionPreparation(const TroikaState& stat
     }
     // Add slice by slice the information of the trits of SRSLC
     if (zStart != SLICES) {
+        // The runs of consecutive active slices, as (number of slices, first z)
+        vector<pair<unsigned int, unsigned int> > runs; 
         for (unsigned int i = 0; i < SLICES; i++) {
             z = (zStart - i + SLICES) % SLICES; 
             if (possibleActiveTritsAtSRSLC.isSliceActive(z)) {
-                addInfoOfTheTritsOfTheSlice(z);  
+                if (!possibleActiveTritsAtSRSLC.isSliceActive((z + 1) % SLICES))
+                    runs.push_back(pair<unsigned int, unsigned int>(0, z)); 
+                runs.back().first++; 
             }
         }
+        if (partsOrder == closingSlicesFirstPartsOrder)
+            stable_sort(runs.begin(), runs.end(), 
+                        [](const pair<unsigned int, unsigned int>& a, 
+                           const pair<unsigned int, unsigned int>& b) 
+                        { return a.first < b.first; }); 
+        vector<pair<unsigned int, unsigned int> >::const_iterator it; 
+        for (it = runs.begin(); it != runs.end(); ++it) {
+            for (unsigned int i = 0; i < it->first; i++)
+                addInfoOfTheTritsOfTheSlice((it->second - i + SLICES) % SLICES); 
+        }
     }
     else {
         // all the slices are active
@@ -103,6 +120,34 @@ ForwardExtensionPreparation::ForwardExtensionPreparation(const TroikaState& stat
                 tritsInfoAtSRSLC.back().mustCalculateTheCostOfTheNextSlice = true; 
         }
     }
+    initConstraintForActiveTritsAtC(stateB);
+    sortTheTritsOfTheSlices();
+}
+
+void ForwardExtensionPreparation::set(const TroikaState& stateB, 
+                                      WeightBound aMaxWeightExtension)
+{
+    if (!hasSameActiveTrytes(stateB)) {
+        WeightBound aMinWeightExtension = minWeightExtension; 
+        *this = ForwardExtensionPreparation(stateB, aMaxWeightExtension); 
+        minWeightExtension = aMinWeightExtension; 
+        return; 
+    }
+    maxWeightExtension = aMaxWeightExtension; 
+    initConstraintForActiveTritsAtC(stateB);
+    sortTheTritsOfTheSlices();
+}
+
+bool ForwardExtensionPreparation::hasSameActiveTrytes(const TroikaState& stateB) const
+{
+    if (tritsInfoAtSRSLC.empty() || (stateB.getNrActiveTrytes() != posForSTCompatibility.size()))
+        return false; 
+    vector<TrytePosition>::const_iterator it; 
+    for (it = posForSTCompatibility.begin(); it != posForSTCompatibility.end(); it++) {
+        if (!stateB.isTryteActive(it->x, it->y, it->z))
+            return false; 
+    }
+    return true; 
 }
 
 void ForwardExtensionPreparation::initPosForSTCompatibility(const TroikaState& stateB)
@@ -118,8 +163,22 @@ void ForwardExtensionPreparation::initPosForSTCompatibility(const TroikaState& s
 
 }
 
-void ForwardExtensionPreparation::
-initPossibleActiveTritsAtSRSLCAndConstraintForActiveTritsAtC(const TroikaState &stateB)
+void ForwardExtensionPreparation::initPossibleActiveTritsAtSRSLC()
+{
+    TritPosition t; 
+    vector<TrytePosition>::const_iterator it; 
+
+    for (it = posForSTCompatibility.begin(); 
+         it != posForSTCompatibility.end(); it++) {
+        for (unsigned int tritIndex = 0; tritIndex < 3; tritIndex++) {
+            t.set(*it, tritIndex);
+            t.SRSL(); 
+            possibleActiveTritsAtSRSLC.activateTrit(t);
+        }
+    }
+}
+
+void ForwardExtensionPreparation::initConstraintForActiveTritsAtC(const TroikaState &stateB)
 {
     TritPosition t; 
     unsigned int tryteValueAtB; 
@@ -135,8 +194,6 @@ initPossibleActiveTritsAtSRSLCAndConstraintForActiveTritsAtC(const TroikaState &
         // first trit
         t.set(3 * it->x, it->y, it->z);
         constraintAtC[t] = noConstraint;
-        t.SRSL(); 
-        possibleActiveTritsAtSRSLC.activateTrit(t);
 
         // second trit 
         if (tryteValueAtB == 9 || tryteValueAtB == 18)
@@ -145,8 +202,6 @@ initPossibleActiveTritsAtSRSLCAndConstraintForActiveTritsAtC(const TroikaState &
             constraint = noConstraint; 
         t.set(3 * it->x + 1, it->y, it->z);
         constraintAtC[t] = constraint;
-        t.SRSL(); 
-        possibleActiveTritsAtSRSLC.activateTrit(t);
 
         // third trit
         if (tryteValueAtB == 1)
@@ -157,14 +212,50 @@ initPossibleActiveTritsAtSRSLCAndConstraintForActiveTritsAtC(const TroikaState &
             constraint = noConstraint; 
         t.set(3 * it->x + 2, it->y, it->z); 
         constraintAtC[t] = constraint;
-        t.SRSL(); 
-        possibleActiveTritsAtSRSLC.activateTrit(t);
+    }
+}
 
+unsigned int ForwardExtensionPreparation::getNrPossibleValues(const TritInfo& trit) const
+{
+    ConstraintForTritValue constraint = constraintAtC.find(trit.posAtC)->second; 
+    if (constraint == noConstraint)
+        return 3; 
+    if (constraint == cannotBe0)
+        return 2; 
+    return 1; 
+}
+
+void ForwardExtensionPreparation::sortTheTritsOfTheSlices()
+{
+    if (partsOrder == slicePartsOrder)
+        return; 
+    vector<pair<size_t, size_t> >::const_iterator slice; 
+    for (slice = slices.begin(); slice != slices.end(); slice++) {
+        vector<TritInfo>::iterator first = tritsInfoAtSRSLC.begin() + slice->first; 
+        vector<TritInfo>::iterator last = tritsInfoAtSRSLC.begin() + slice->second; 
+        // the flags belong to the last trit of the slice
+        bool mustCalculateTheCostOfTheSlice = (last - 1)->mustCalculateTheCostOfTheSlice; 
+        bool mustCalculateTheCostOfTheNextSlice = (last - 1)->mustCalculateTheCostOfTheNextSlice; 
+        (last - 1)->mustCalculateTheCostOfTheSlice = false; 
+        (last - 1)->mustCalculateTheCostOfTheNextSlice = false; 
+        // the ties are kept in the order of the positions, as in slicePartsOrder
+        sort(first, last, [this](const TritInfo& a, const TritInfo& b) {
+            unsigned int nrValuesA = getNrPossibleValues(a); 
+            unsigned int nrValuesB = getNrPossibleValues(b); 
+            if (nrValuesA != nrValuesB)
+                return nrValuesA < nrValuesB; 
+            if (a.posAtSRSLC.x != b.posAtSRSLC.x)
+                return a.posAtSRSLC.x < b.posAtSRSLC.x; 
+            return a.posAtSRSLC.y < b.posAtSRSLC.y; 
+        }); 
+        (last - 1)->mustCalculateTheCostOfTheSlice = mustCalculateTheCostOfTheSlice; 
+        (last - 1)->mustCalculateTheCostOfTheNextSlice = mustCalculateTheCostOfTheNextSlice; 
     }
 }
 
 void ForwardExtensionPreparation::addInfoOfTheTritsOfTheSlice(unsigned int z)
 { 
+    size_t firstOfTheSlice = tritsInfoAtSRSLC.size(); 
     for (unsigned int x = 0; x < COLUMNS; x++) {
         for (unsigned int y = 0; y < ROWS; y++) {
             if (possibleActiveTritsAtSRSLC.isTritActive(x, y, z)) {
@@ -172,6 +263,7 @@ void ForwardExtensionPreparation::addInfoOfTheTritsOfTheSlice(unsigned int z)
             }
         }
     }
+    slices.push_back(pair<size_t, size_t>(firstOfTheSlice, tritsInfoAtSRSLC.size())); 
     tritsInfoAtSRSLC.back().mustCalculateTheCostOfTheSlice = true;
     if (!possibleActiveTritsAtSRSLC.isSliceActive((z - 1 + SLICES) % SLICES))
         tritsInfoAtSRSLC.back().mustCalculateTheCostOfTheNextSlice = true; 
@@ -200,10 +292,16 @@ ostream & operator << (ostream& fout, const ForwardExtensionPreparation& prep)
 
 ForwardExtensionCache::ForwardExtensionCache(ForwardExtensionPreparation& prep, 
     const TroikaState& stateB):
-constraintAtC(prep.constraintAtC)
+constraintAtC(prep.constraintAtC), nrChosenTrytesC(0), nrIncompatibleTrytesC(0)
 {
-    (void) stateB;
     stackNrActiveTrytesD.push(0); 
+    // Only the trytes of C in the active trytes of B can have chosen trits 
+    vector<TrytePosition>::const_iterator it; 
+    for (it = prep.posForSTCompatibility.begin(); 
+         it != prep.posForSTCompatibility.end(); it++) {
+        trytesAtB[it->x][it->y][it->z] = (unsigned int)stateB.getTryte(it->x, it->y, it->z); 
+        nrChosenTritsAtC[it->x][it->y][it->z] = 0; 
+    }
     for (unsigned int x = 0; x < COLUMNS; x++) {
         for (unsigned int z = 0; z < SLICES; z++) {
             columnParityOfSRSLC[x][z] = 0; 
@@ -224,6 +322,10 @@ void ForwardExtensionCache::push(const TritInfo &trit)
     if (trit.value == 0)
         nrNonActiveTritsAtC[TrytePosition(trit.posAtC)] += 1; 
 
+    TrytePosition tryteC(trit.posAtC); 
+    if (++nrChosenTritsAtC[tryteC.x][tryteC.y][tryteC.z] == 3)
+        addTransitionWeight(tryteC); 
+
     if (trit.mustCalculateTheCostOfTheSlice) {
         setTheColumnParityOfTheSliceAtSRSLC(t.z);
         applyToTheSliceAddColumnParity(t.z);
@@ -244,6 +346,10 @@ void ForwardExtensionCache::pop(const TritInfo &trit)
     TritPosition t = trit.posAtSRSLC;
     tritsAtSRSLC[t.x][t.y][t.z] = 0;
 
+    TrytePosition tryteC(trit.posAtC); 
+    if (nrChosenTritsAtC[tryteC.x][tryteC.y][tryteC.z]-- == 3)
+        removeTransitionWeight(tryteC); 
+
     if (trit.value == 0)
         nrNonActiveTritsAtC[TrytePosition(trit.posAtC)] -= 1; 
 
@@ -297,6 +403,36 @@ unsigned int ForwardExtensionCache::getNrActiveTrytesOfTheSliceAtD(
     return nrActiveTrytesAtD; 
 }
 
+void ForwardExtensionCache::addTransitionWeight(const TrytePosition& tryte)
+{
+    unsigned int valueC = 0; 
+    for (unsigned int tritIndex = 0; tritIndex < 3; tritIndex++) {
+        TritPosition t; 
+        t.set(tryte, tritIndex); 
+        t.SRSL(); 
+        valueC = 3 * valueC + tritsAtSRSLC[t.x][t.y][t.z]; 
+    }
+    Weight& weight = weightsBC[tryte.x][tryte.y][tryte.z]; 
+    weight = Weight(0); 
+    if (sbox.areSTCompatible(Tryte(trytesAtB[tryte.x][tryte.y][tryte.z]), Tryte(valueC), weight)) {
+        nrChosenTrytesC++; 
+        weightBCOfChosenTrytes += weight; 
+    }
+    else
+        nrIncompatibleTrytesC++; 
+}
+
+void ForwardExtensionCache::removeTransitionWeight(const TrytePosition& tryte)
+{
+    const Weight& weight = weightsBC[tryte.x][tryte.y][tryte.z]; 
+    if (weight == Weight(0))
+        nrIncompatibleTrytesC--; 
+    else {
+        nrChosenTrytesC--; 
+        weightBCOfChosenTrytes -= weight; 
+    }
+}
+
 ostream & operator << (ostream& fout, const ForwardExtensionCache& cache)
 {
     for (map<TritPosition, ConstraintForTritValue>::const_iterator it = cache.constraintAtC.begin(); 
@@ -357,7 +493,12 @@ CostFunctionForwardExtension::CostFunctionForwardExtension(ForwardExtensionPrepa
 bool CostFunctionForwardExtension::tooHighCost(const ForwardExtensionCache& cache,
                                                int indCurPart) const
 {
-    if ( 2 * (cache.stackNrActiveTrytesD.top() + nrActiveTrytesC) > maxWeightExtension ) 
+    if (cache.nrIncompatibleTrytesC > 0)
+        return true; 
+    Weight lowerBound = Weight(2 * (cache.stackNrActiveTrytesD.top() + nrActiveTrytesC 
+                                    - cache.nrChosenTrytesC))
+                        + cache.weightBCOfChosenTrytes; 
+    if (lowerBound > maxWeightExtension) 
         return true; 
     return false; 
 }
@@ -366,16 +507,21 @@ ForwardExtension::ForwardExtension(const ForwardExtensionPreparation& prep, cons
 :stateB(stateB), posForSTCompatibility(prep.posForSTCompatibility){}
 
 
-ForwardExtension::ForwardExtension(const TroikaState& aStateB, const vector<TrytePosition> posForSTCompatibility)
+ForwardExtension::ForwardExtension(const TroikaState& aStateB, const vector<TrytePosition>& posForSTCompatibility)
 : stateB(aStateB), posForSTCompatibility(posForSTCompatibility){}
 
-bool ForwardExtension::isValidAndBelowWeight(long double maxWeightExtension) const
+bool ForwardExtension::isValidAndBelowWeight(WeightBound maxWeightExtension) const
 {
-    if ( valid && ((long double)getWeight() <= maxWeightExtension) ) 
+    if ( valid && (getWeight() <= maxWeightExtension) ) 
         return true; 
     return false; 
 }
 
+bool ForwardExtension::isAboveWeight(WeightBound minWeightExtension) const
+{
+    return getWeight() > minWeightExtension; 
+}
+
 void ForwardExtension::setStateCAndDFromStateD(const TroikaState& aStateD)
 {
     stateD = aStateD; 
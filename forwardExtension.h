@@ -87,13 +87,20 @@ class TritInfo {
 };
 
 /** Given the state B, the class initializes the attributes needed for 
-  * the extension. 
+  * the extension. The positions of the trits, and their order, only depend 
+  * on the active trytes of B, and the constraints at C on the values of the 
+  * trytes of B: the preparation can be set to another state B with the same
+  * active trytes by updating the constraints only (see set()). 
   */ 
 class ForwardExtensionPreparation 
 {
     public:
         /** Maximum weight for w(B--ST-->C) + wMinDir(D). */ 
-        long double maxWeightExtension; 
+        WeightBound maxWeightExtension; 
+        /** Lower bound, excluded, on the weight of the extensions output by
+          * the iterator. It is 0 by default, which excludes none. 
+          */ 
+        WeightBound minWeightExtension; 
         /** Vector that stores, for all the (3 * nr of active trytes at B) 
           * possible active trits of SRSL(C), information needed about that trit
           * in order to choose its value.
@@ -105,18 +112,47 @@ class ForwardExtensionPreparation
           * value of the trit. 
           */
         map<TritPosition, ConstraintForTritValue> constraintAtC;
+        /** The order of the trits in tritsInfoAtSRSLC, slicePartsOrder by 
+          * default. 
+          */ 
+        static ExtensionPartsOrder partsOrder; 
     private: 
         ActiveState possibleActiveTritsAtSRSLC;
+        /** The index of the first trit and the index after the last trit of
+          * each slice in tritsInfoAtSRSLC. 
+          */ 
+        vector<pair<size_t, size_t> > slices; 
     public: 
+        /** The default constructor. The preparation must be set with set()
+          * before it is used. 
+          */ 
+        ForwardExtensionPreparation() {} 
         ForwardExtensionPreparation(const TroikaState& stateB, 
-                                    long double maxWeightExtension); 
+                                    WeightBound maxWeightExtension); 
+        /** It prepares the extension of @a stateB. If @a stateB has the same
+          * active trytes as the state of the current preparation, only the 
+          * constraints at C (and the order of the trits if it depends on 
+          * them) are updated. Otherwise, the preparation is built again. 
+          */ 
+        void set(const TroikaState& stateB, WeightBound aMaxWeightExtension); 
+        /** It returns true if @a stateB has the same active trytes as the 
+          * state of the current preparation. 
+          */ 
+        bool hasSameActiveTrytes(const TroikaState& stateB) const; 
         vector<TritInfo>& getPartsList(){ return tritsInfoAtSRSLC; }
         bool couldBeExtended() {return true; } 
         friend ostream & operator << (ostream& fout, const ForwardExtensionPreparation& prep);
     private: 
         void initPosForSTCompatibility(const TroikaState& stateB);
-        void initPossibleActiveTritsAtSRSLCAndConstraintForActiveTritsAtC(const TroikaState& stateB);
+        void initPossibleActiveTritsAtSRSLC();
+        void initConstraintForActiveTritsAtC(const TroikaState& stateB);
         void addInfoOfTheTritsOfTheSlice(unsigned int z);
+        /** It returns the number of values allowed for the trit of C by the 
+          * tryte of B: 1, 2 (cannotBe0) or 3. 
+          */ 
+        unsigned int getNrPossibleValues(const TritInfo& trit) const; 
+        /** It sorts the trits of each slice according to partsOrder. */ 
+        void sortTheTritsOfTheSlices(); 
 }; 
 
 /** Auxiliary class for the class ForwardExtensionIterator.
@@ -156,6 +192,32 @@ class ForwardExtensionCache
           * This array is updated each time a new slice of SRSL(C) is chosen.
           */ 
         unsigned int tritsAtD[COLUMNS][ROWS][SLICES];
+        /** For  0 ≤ xTryte < 3,  0 ≤ y < 3,  0 ≤ z < 27, trytesAtB[xTryte][y][z] 
+          * contains the value of the tryte of state B. 
+          */ 
+        unsigned int trytesAtB[3][ROWS][SLICES]; 
+        /** For  0 ≤ xTryte < 3,  0 ≤ y < 3,  0 ≤ z < 27, 
+          * nrChosenTritsAtC[xTryte][y][z] contains the number of trits of the
+          * tryte of C already chosen. 
+          */ 
+        unsigned int nrChosenTritsAtC[3][ROWS][SLICES]; 
+        /** For the trytes of C whose 3 trits are chosen, weightsBC[xTryte][y][z]
+          * contains the weight of the transition from the tryte of B. 
+          */ 
+        Weight weightsBC[3][ROWS][SLICES]; 
+        /** The number of trytes of C whose 3 trits are chosen and compatible 
+          * with the tryte of B. 
+          */ 
+        unsigned int nrChosenTrytesC; 
+        /** The number of trytes of C whose 3 trits are chosen and not 
+          * compatible with the tryte of B. 
+          */ 
+        unsigned int nrIncompatibleTrytesC; 
+        /** The weight of the transitions of the chosen and compatible trytes 
+          * of C, ie the part of w(B--ST-->C) already known. 
+          */ 
+        Weight weightBCOfChosenTrytes; 
+        Sbox sbox; 
     public: 
         ForwardExtensionCache(ForwardExtensionPreparation& prep, const TroikaState& stateB);
         friend ostream & operator << (ostream& fout, const ForwardExtensionCache& cache);
@@ -179,16 +241,24 @@ class ForwardExtensionCache
         void addActiveTritsOfTheSliceAtD(unsigned int z) const;
         void removeActiveTritsOfTheSliceAtD(unsigned int z) const;
         unsigned int getNrActiveTrytesOfTheSliceAtD(unsigned int z) const;
+        /** It adds the weight of the transition of the tryte of C of 
+          * position @a tryte, whose 3 trits have just been chosen. 
+          */ 
+        void addTransitionWeight(const TrytePosition& tryte); 
+        void removeTransitionWeight(const TrytePosition& tryte); 
 };
 
 /** Class used by the ForwardExtensionIterator to test if the extension 
   * that is being formed or is already formed has a too high weight.
+  * The lower bound on w(B--ST-->C) + wMinDir(D) is 2 per active tryte of D 
+  * found so far, plus the weight of the transitions of the trytes of C 
+  * already chosen and 2 per tryte of C still to choose. 
   */ 
 class CostFunctionForwardExtension
 {
     public:
         /** Maximum weight for w(B-->C) + wMinDir(D). */ 
-        long double maxWeightExtension; 
+        WeightBound maxWeightExtension; 
         unsigned int nrActiveTrytesC;
     public: 
         CostFunctionForwardExtension(ForwardExtensionPreparation &prep, const TroikaState& stateB); 
@@ -218,11 +288,15 @@ class ForwardExtension {
         bool valid; 
     public: 
         ForwardExtension(const ForwardExtensionPreparation& prep, const TroikaState &stateB);
-        ForwardExtension(const TroikaState& aStateB, const vector<TrytePosition> posForSTCompatibility);
+        ForwardExtension(const TroikaState& aStateB, const vector<TrytePosition>& posForSTCompatibility);
         /** It returns true if the extension is valid and has a weight below
           * @a maxWeightExtension.
           */ 
-        bool isValidAndBelowWeight(double long maxExtensionWeight) const;
+        bool isValidAndBelowWeight(WeightBound maxExtensionWeight) const;
+        /** It returns true if the extension has a weight strictly above 
+          * @a minWeightExtension.
+          */ 
+        bool isAboveWeight(WeightBound minWeightExtension) const;
         void setStateCAndDFromStateD(const TroikaState& aStateD); 
         /** This method is called when all the parts of the extension are chosen.
           * It updates the attributes of the ForwardExtension using information 
@@ -4,7 +4,7 @@
 
          
 ForwardInKernelExtensionPreparation::ForwardInKernelExtensionPreparation
-                                         (long double aMaxWeightExtension,  
+                                         (WeightBound aMaxWeightExtension,  
                                           const ActiveState& activeB):
 maxWeightExtension(aMaxWeightExtension)
 {
@@ -21,7 +21,7 @@ maxWeightExtension(aMaxWeightExtension)
     if (extensionPossible) {
         initializeMandatoryActiveTritsAtCandD(activeB);
         int minWeightExtension = 2 * (posActiveTrytesC.size() + mandatoryActiveTritsAtC.getNrActiveTrytes());
-        if ( minWeightExtension > maxWeightExtension) 
+        if ( Weight(minWeightExtension) > maxWeightExtension) 
             extensionPossible = false; 
     }
 }
@@ -26,7 +26,7 @@
 class ForwardInKernelExtensionPreparation {
     public:
         /* Maximum weight for w(B-->C) + wMinDir(D). */ 
-        const long double maxWeightExtension; 
+        const WeightBound maxWeightExtension; 
         vector <TrytePosition> posActiveTrytesC;
         ActiveState possibleActiveTritsAtC; 
         ActiveState mandatoryActiveTritsAtC; 
@@ -42,7 +42,7 @@ class ForwardInKernelExtensionPreparation {
          * @param aMaxWeightExtension maximum for the weight w(B-->C) + wMinDir(D)
          * @param activeB The trit activity pattern of B
          */
-        ForwardInKernelExtensionPreparation(long double aMaxWeightExtension,  
+        ForwardInKernelExtensionPreparation(WeightBound aMaxWeightExtension,  
                                             const ActiveState& activeB);
         bool couldBeExtended() const; 
         friend ostream & operator << (ostream &fout, const ForwardInKernelExtensionPreparation& prep);
@@ -77,7 +77,7 @@ class ForwardInKernelExtensionPreparation {
 class ForwardInKernelExtensionIterator {
     private: 
         /** The maximum weight for w(B--ST-->C) + wMinDir(D). */ 
-        const long double maxWeightExtension; 
+        const WeightBound maxWeightExtension; 
         /** Variable used to store a valid extension. */ 
         ForwardExtension extension;
         /** Variable used to find all the states D that are in the kernel and 
@@ -1,4 +1,5 @@
 /* main.cpp */
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <ostream>
@@ -6,6 +7,10 @@
 #include <set>
 #include "3RoundsTrailCores.h"
 #include "KK_trailCores.h"
+#include "memoryAccounting.h"
+#include "perfCounters.h"
+#include "progressReporter.h"
+#include "trace.h"
 #include "trailCoreExtension.h"
 
 int main() {
@@ -23,13 +28,40 @@ int main() {
      unsigned int T3 = 35;
      unsigned int T1 = 11; 
 
+    // Store one state per round in the trail core files (half the size). 
+    // TrailCore::compactStorage = true; 
+
+    // Report the progress every minute on cerr and in the file progress.txt, 
+    // if the environment variable PROGRESS is set. 
+    if (getenv("PROGRESS") != NULL)
+        progress.start("progress.txt", 60); 
+
+    // Record the phases in trace.json (Chrome trace format), one trail core 
+    // out of 1000. 
+    // Tracer::start("trace.json", 1000); 
+
+    // Measure the cycles, instructions, cache and branch misses per phase 
+    // (see the report at the end). 
+    // PerfCounters::start(); 
+
+    // Limit the memory of the sets of trail cores (spilled to files beyond). 
+    // MemoryAccounting::setBudget(4LL << 30); 
+
     // KK TRAIL CORES
     KK_TrailCores KK(T3); 
     KK.generate_KK_trailCores(); 
+    // Or from the file of a previous run up to weight 33. 
+    // KK.generate_KK_trailCoresFrom(33); 
+    // Or only the band of weights (33, 35], eg on another machine. 
+    // KK.generate_KK_trailCoresInBand(33); 
+    // Only the 10 lightest KK trail cores, in weight order. 
+    // KK.generateLowestWeightTrailCores(10); 
     
     // KN TRAIL CORES 
     /*
     KN_TrailCores KN(T3, T1); 
+    // Or only the trail cores above 33, merged into KN-33-verif. 
+    // KN.searchFrom(33); 
     KN.K_TrailCores(); 
     KN.KN_FromForwardExtension(); 
     KN.KN_FromInKernelExtension(); 
@@ -53,6 +85,9 @@ int main() {
     NN.nrTrailsFound();
     */ 
 
+    // PerfCounters::report(cout); 
+    MemoryAccounting::report(cout); 
+
     return 0; 
 }
 
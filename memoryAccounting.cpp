@@ -0,0 +1,31 @@
+/* memoryAccounting.cpp */
+#include <iomanip>
+#include "memoryAccounting.h"
+
+atomic<long long> MemoryAccounting::liveBytes[nrMemoryCategories];
+atomic<long long> MemoryAccounting::peakBytes[nrMemoryCategories];
+atomic<UINT64> MemoryAccounting::nrAllocations[nrMemoryCategories];
+atomic<long long> MemoryAccounting::totalLiveBytes(0);
+atomic<long long> MemoryAccounting::budget(0);
+
+const char* MemoryAccounting::getName(MemoryCategory category)
+{
+    static const char* names[nrMemoryCategories] = {"patterns", "trail sets",
+        "S-box tables", "iterators", "extension cache"};
+    return names[category];
+}
+
+void MemoryAccounting::report(ostream& fout)
+{
+    fout << left << setw(16) << "memory" << right << setw(14) << "live bytes";
+    fout << setw(14) << "peak bytes" << setw(14) << "allocations" << endl;
+    for (unsigned int i = 0; i < nrMemoryCategories; i++) {
+        MemoryCategory category = (MemoryCategory)i;
+        fout << left << setw(16) << getName(category) << right << dec;
+        fout << setw(14) << getLiveBytes(category) << setw(14) << getPeakBytes(category);
+        fout << setw(14) << getNrAllocations(category) << endl;
+    }
+    long long limit = budget.load(memory_order_relaxed);
+    if (limit > 0)
+        fout << "budget: " << limit << " bytes" << (isOverBudget() ? " (exceeded)" : "") << endl;
+}
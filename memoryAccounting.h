@@ -0,0 +1,176 @@
+/* memoryAccounting.h */
+#ifndef MEMORYACCOUNTING_H
+#define MEMORYACCOUNTING_H
+
+/*
+The classes of this file account for the memory used by the main data
+structures of the searches, per category: the live bytes, the peak of the
+live bytes and the number of allocations. The containers use the allocator
+AccountedAllocator, and the structures that are not containers (eg the
+tables of the S-box) are counted explicitly.
+
+An optional memory budget can be set: the components that can work with less
+memory (eg checkTrailAndParity, which then spills its set of trail cores to
+files) check MemoryAccounting::isOverBudget(category) for their own category
+and degrade instead of growing.
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <iostream>
+#include <new>
+#include "types.h"
+
+enum MemoryCategory {
+    /** The set of the patterns of the KK search (ActiveStatesCAndDCache::patternsC). */
+    memoryPatterns,
+    /** The sets of trail cores (eg in checkTrailAndParity). */
+    memoryTrailSets,
+    /** The tables of the S-box. */
+    memorySboxTables,
+    /** The vectors of the tree iterators. */
+    memoryIterators,
+    /** The extensions stored by the ExtensionCache. */
+    memoryExtensionCache,
+    nrMemoryCategories
+};
+
+class MemoryAccounting {
+    protected:
+        static atomic<long long> liveBytes[nrMemoryCategories];
+        static atomic<long long> peakBytes[nrMemoryCategories];
+        static atomic<UINT64> nrAllocations[nrMemoryCategories];
+        static atomic<long long> totalLiveBytes;
+        /** The budget in bytes, or 0 if there is none. */
+        static atomic<long long> budget;
+    public:
+        static void allocate(MemoryCategory category, size_t bytes)
+        {
+            long long live = liveBytes[category].fetch_add(bytes, memory_order_relaxed) + bytes;
+            long long peak = peakBytes[category].load(memory_order_relaxed);
+            while ((live > peak)
+                   && !peakBytes[category].compare_exchange_weak(peak, live, memory_order_relaxed));
+            nrAllocations[category].fetch_add(1, memory_order_relaxed);
+            totalLiveBytes.fetch_add(bytes, memory_order_relaxed);
+        }
+        static void deallocate(MemoryCategory category, size_t bytes)
+        {
+            liveBytes[category].fetch_sub(bytes, memory_order_relaxed);
+            totalLiveBytes.fetch_sub(bytes, memory_order_relaxed);
+        }
+        static long long getLiveBytes(MemoryCategory category)
+        {
+            return liveBytes[category].load(memory_order_relaxed);
+        }
+        static long long getPeakBytes(MemoryCategory category)
+        {
+            return peakBytes[category].load(memory_order_relaxed);
+        }
+        static UINT64 getNrAllocations(MemoryCategory category)
+        {
+            return nrAllocations[category].load(memory_order_relaxed);
+        }
+        /** It sets the memory budget of the accounted structures, in bytes
+          * (0 for no budget).
+          */
+        static void setBudget(long long bytes)
+        {
+            budget.store(bytes, memory_order_relaxed);
+        }
+        /** It indicates whether the accounted structures use more memory
+          * than the budget.
+          */
+        static bool isOverBudget()
+        {
+            long long limit = budget.load(memory_order_relaxed);
+            return (limit > 0) && (totalLiveBytes.load(memory_order_relaxed) > limit);
+        }
+        /** It indicates whether the structures of @a category use more 
+          * memory than their share of the budget, ie the budget minus the
+          * memory used by the other categories. Only the structures of 
+          * @a category are compared, since only they can be reduced by the
+          * caller. 
+          */
+        static bool isOverBudget(MemoryCategory category)
+        {
+            long long limit = budget.load(memory_order_relaxed);
+            if (limit <= 0)
+                return false;
+            long long live = liveBytes[category].load(memory_order_relaxed);
+            long long others = totalLiveBytes.load(memory_order_relaxed) - live;
+            return live > limit - others;
+        }
+        static const char* getName(MemoryCategory category);
+        /** It outputs the live bytes, peak bytes and number of allocations
+          * of each category.
+          */
+        static void report(ostream& fout);
+};
+
+/** A number of bytes accounted in a category, eg the capacity of the
+  * vectors of an object. A copy accounts for the same number of bytes again,
+  * and the bytes are released at destruction.
+  */
+class MemoryCounter {
+    protected:
+        MemoryCategory category;
+        size_t bytes;
+    public:
+        MemoryCounter(MemoryCategory aCategory): category(aCategory), bytes(0) {}
+        MemoryCounter(const MemoryCounter& other): category(other.category), bytes(0)
+        {
+            set(other.bytes);
+        }
+        MemoryCounter& operator = (const MemoryCounter& other)
+        {
+            set(other.bytes);
+            return *this;
+        }
+        ~MemoryCounter()
+        {
+            set(0);
+        }
+        /** It sets the number of bytes accounted. */
+        void set(size_t newBytes)
+        {
+            if (newBytes > bytes)
+                MemoryAccounting::allocate(category, newBytes - bytes);
+            else if (newBytes < bytes)
+                MemoryAccounting::deallocate(category, bytes - newBytes);
+            bytes = newBytes;
+        }
+};
+
+/** An allocator for the standard containers that accounts for the memory
+  * allocated in the category @a category.
+  */
+template<class T, MemoryCategory category>
+class AccountedAllocator {
+    public:
+        typedef T value_type;
+        template<class U>
+        struct rebind {
+            typedef AccountedAllocator<U, category> other;
+        };
+    public:
+        AccountedAllocator() {}
+        template<class U>
+        AccountedAllocator(const AccountedAllocator<U, category>&) {}
+        T* allocate(size_t n)
+        {
+            T* elements = static_cast<T*>(::operator new(n * sizeof(T)));
+            MemoryAccounting::allocate(category, n * sizeof(T));
+            return elements;
+        }
+        void deallocate(T* elements, size_t n)
+        {
+            MemoryAccounting::deallocate(category, n * sizeof(T));
+            ::operator delete(elements);
+        }
+        template<class U>
+        bool operator == (const AccountedAllocator<U, category>&) const { return true; }
+        template<class U>
+        bool operator != (const AccountedAllocator<U, category>&) const { return false; }
+};
+
+#endif
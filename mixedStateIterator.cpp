@@ -1,6 +1,7 @@
 /** mixedStateIterator.cpp */
 #include "mixedStateIterator.h"
 #include "bareStateIterator.h"
+#include "progressReporter.h"
 #include "state.h"
 #include "trailCore.h"
 #include "troikaStateIterator.h"
@@ -176,8 +177,8 @@ ActiveTrailCoreCache::ActiveTrailCoreCache()
 MixedTrailCoreCache::MixedTrailCoreCache(const BareState& bareState)
 {
     kernel = false;
-    activeA.set(bareState.stateA);
-    activeB.set(bareState.stateB);
+    activeA.set(*bareState.stateA);
+    activeB.set(*bareState.stateB);
     wA.push(bareState.wA); 
     wB.push(bareState.wB);
     nrComponents = bareState.nrComponents;
@@ -241,11 +242,29 @@ void ActiveTrailCoreCache::pop(const ActiveTrits& activeTrits)
     }
 }
     
-void TwoRoundTrailCore::save(ostream& fout)
+const ActiveState& TwoRoundTrailCore::getActiveA() const
+{
+    return (mixedCache != NULL) ? mixedCache->activeA : inKernelCache->activeA; 
+}
+
+const ActiveState& TwoRoundTrailCore::getActiveB() const
+{
+    return (mixedCache != NULL) ? mixedCache->activeB : inKernelCache->activeB; 
+}
+
+TroikaStateIterator TwoRoundTrailCore::getStatesB() const
+{
+    if (mixedCache != NULL)
+        return TroikaStateIterator(*mixedCache); 
+    return TroikaStateIterator(*inKernelCache); 
+}
+
+void TwoRoundTrailCore::save(ostream& fout) const
 {
     TroikaState stateB; 
     TroikaState stateA; 
-    for (statesB.first(); !statesB.isEnd(); ++statesB) {
+    TroikaStateIterator statesB = getStatesB(); 
+    for (; !statesB.isEnd(); ++statesB) {
         stateB = *statesB; 
         stateA.setInvL(stateB); 
         TrailCore trail(stateA, stateB, wA, wB); 
@@ -262,10 +281,8 @@ void TwoRoundTrailCore::set(const vector<ActiveTrits>& unitList,
     (void) costF; 
     wA = cache.wA.top(); 
     wB = cache.wB.top();
-    statesB = TroikaStateIterator(cache);
-    activeA = cache.activeA;
-    activeB = cache.activeB; 
-
+    inKernelCache = &cache; 
+    mixedCache = NULL; 
 }
 
 void TwoRoundTrailCore::set(const vector<ActiveTrits>& unitList,
@@ -277,9 +294,8 @@ void TwoRoundTrailCore::set(const vector<ActiveTrits>& unitList,
     (void) costF; 
     wA = cache.wA.top(); 
     wB = cache.wB.top();
-    statesB = TroikaStateIterator(cache);
-    activeA = cache.activeA;
-    activeB = cache.activeB; 
+    inKernelCache = NULL; 
+    mixedCache = &cache; 
 }
 
 unsigned int TwoRoundTrailCoreCostFunction::getCost(
@@ -287,21 +303,51 @@ unsigned int TwoRoundTrailCoreCostFunction::getCost(
                                const ActiveTrailCoreCache& cache) const
 {
     (void) unitList; 
-    return alpha*cache.wA.top() + beta*cache.wB.top();
+    unsigned int cost = alpha*cache.wA.top() + beta*cache.wB.top();
+    if ((alpha2 == 0 && beta2 == 0) || (cost <= maxCost))
+        return cost; 
+    if (alpha2*cache.wA.top() + beta2*cache.wB.top() <= maxCost2)
+        return maxCost; 
+    return cost;
 }
 
 void traverse_K_TrailCoresTree(unsigned int aMaxCost,
                                unsigned int alpha,
                                unsigned int beta, 
-                               ostream &fout)
+                               ostream &fout, 
+                               TraversalStatistics* statistics)
 {
     TwoRoundTrailCoreCostFunction costFRun(alpha, beta);  
+    traverse_K_TrailCoresTree(costFRun, aMaxCost, 
+                              [&fout](const TrailCore& trail) { trail.save(fout); }, 
+                              statistics); 
+}
+
+void traverse_K_TrailCoresTree(const TwoRoundTrailCoreCostFunction& costF, 
+                               unsigned int aMaxCost,
+                               const function<void(const TrailCore&)>& process, 
+                               TraversalStatistics* statistics, 
+                               unsigned int aMinCost)
+{
     ActiveTrailCoreCache activeTritsCache;  
     ActiveTritsSet activeTritsSet;  
+    TroikaState stateA; 
+    TroikaState stateB; 
 
-    K_TrailCore_Iterator iteratorTrits(activeTritsSet, activeTritsCache, costFRun, aMaxCost, true); 
+    K_TrailCore_Iterator iteratorTrits(activeTritsSet, activeTritsCache, costF, aMaxCost, false, aMinCost); 
+    progress.setNrFirstLevelUnits(iteratorTrits.countFirstLevelUnits());
+    ++iteratorTrits;
     for (; !iteratorTrits.isEnd(); ++iteratorTrits) {
-        TwoRoundTrailCore trails = *iteratorTrits; 
-        trails.save(fout);
+        progress.addNodes();
+        progress.setPrefix(iteratorTrits.nrFirstLevelNodes);
+        const TwoRoundTrailCore& trails = *iteratorTrits; 
+        TroikaStateIterator statesB = trails.getStatesB(); 
+        for (; !statesB.isEnd(); ++statesB) {
+            stateB = *statesB; 
+            stateA.setInvL(stateB); 
+            process(TrailCore(stateA, stateB, trails.wA, trails.wB)); 
+        }
     }
+    TRAVERSAL_STATISTICS_ONLY(if (statistics != NULL) *statistics += iteratorTrits.statistics;)
+    (void) statistics; 
 }
@@ -13,6 +13,7 @@ The classes of this file define the tree used to generate the mixed state of the
  2) 2-round out kernel trail cores (see Section 5.2)
 */
 
+#include <functional>
 #include <stack>
 #include "state.h"
 #include "traversal.h"
@@ -217,6 +218,8 @@ class MixedTrailCoreCache : public ActiveTrailCoreCache
 
 /** The output representation of a TwoRoundTrailCore (A, B) generated during the
   * traversal of a N_TrailCore_Iterator or a K_TrailCore_Iterator. 
+  * It is a view on the cache of the iterator: the activity patterns are not 
+  * copied, so the view is only valid until the iterator is incremented.
   */ 
 class TwoRoundTrailCore
 {
@@ -225,17 +228,25 @@ class TwoRoundTrailCore
         unsigned int wA; 
         /** The minimum direct weight of the state B. */ 
         unsigned int wB; 
-        TroikaStateIterator statesB;
-        /** The trit activity pattern of the state A. */ 
-        ActiveState activeA;
-        /** The trit activity pattern of the state B. */ 
-        ActiveState activeB;
+    protected:
+        /** The cache of the K_TrailCore_Iterator, or NULL. */ 
+        const ActiveTrailCoreCache* inKernelCache; 
+        /** The cache of the N_TrailCore_Iterator, or NULL. */ 
+        const MixedTrailCoreCache* mixedCache; 
     public: 
-        TwoRoundTrailCore(): wA(0), wB(0){};
+        TwoRoundTrailCore(): wA(0), wB(0), inKernelCache(NULL), mixedCache(NULL){};
+        /** It returns the trit activity pattern of the state A. */ 
+        const ActiveState& getActiveA() const; 
+        /** It returns the trit activity pattern of the state B. */ 
+        const ActiveState& getActiveB() const; 
+        /** It returns an iterator over the states B compatible with the
+          * trit activity pattern of B. 
+          */ 
+        TroikaStateIterator getStatesB() const; 
         /** This methods outputs the 2-round trail core to save it in, e.g., a file.
 	      * @param fout The stream to save the trail core to.
 	      */
-        void save(ostream& fout);
+        void save(ostream& fout) const;
         /** This methods sets the trail. It is used by a K_TrailCore_Iterator.
        	  * @param unitList The list of activeTrits representing the trail.
           * @param cache The cache representation of the trail.
@@ -262,17 +273,30 @@ class TwoRoundTrailCore
   * generated during the traversal of a K_TrailCore_Iterator or a 
   * N_TrailCore_Iterator and of its children.
   * The cost of a 2-round trail core (A, B) is alpha * wMinRev(A) + beta * wMinDir(b)
+  * With a second weighting, a traversal covers the union of two cost regions
+  * (see TwoRoundTrailCoreCostBoundFunction). 
   */
 class TwoRoundTrailCoreCostFunction {
 
     public:
         unsigned int alpha;
         unsigned int beta;
+        /** The second weighting, not used if alpha2 = beta2 = 0. */ 
+        unsigned int alpha2; 
+        unsigned int beta2; 
+        unsigned int maxCost; 
+        unsigned int maxCost2; 
     public:
         TwoRoundTrailCoreCostFunction()
-            : alpha(1), beta(1){}
+            : alpha(1), beta(1), alpha2(0), beta2(0), maxCost(0), maxCost2(0){}
         TwoRoundTrailCoreCostFunction(unsigned int aAlpha, unsigned int aBeta)
-            : alpha(aAlpha), beta(aBeta) {}
+            : alpha(aAlpha), beta(aBeta), alpha2(0), beta2(0), maxCost(0), maxCost2(0) {}
+        TwoRoundTrailCoreCostFunction(unsigned int aAlpha, unsigned int aBeta,
+                                      unsigned int aMaxCost, 
+                                      unsigned int aAlpha2, unsigned int aBeta2,
+                                      unsigned int aMaxCost2)
+            : alpha(aAlpha), beta(aBeta), alpha2(aAlpha2), beta2(aBeta2), 
+              maxCost(aMaxCost), maxCost2(aMaxCost2) {}
 	    /** It returns the bound on the cost of the trail core and 
           * its children.
           */ 
@@ -282,9 +306,26 @@ class TwoRoundTrailCoreCostFunction {
 
 /** This function save in @fout all the 2-round trail cores (A, B)
   * of cost @alpha * wMinRev(A) + @beta * wMinDir(b) below @aMaxCost.
+  * If TRAVERSAL_STATISTICS is defined and @statistics is not NULL, the 
+  * statistics of the traversal are added to @statistics. 
   */ 
 void traverse_K_TrailCoresTree(unsigned int aMaxCost,
                                unsigned int alpha,
                                unsigned int beta, 
-                               ostream &fout); 
+                               ostream &fout, 
+                               TraversalStatistics* statistics = NULL); 
+
+/** This function calls @process for all the 2-round trail cores (A, B)
+  * of cost at most @aMaxCost for @costF, one call per state B. 
+  * If TRAVERSAL_STATISTICS is defined and @statistics is not NULL, the 
+  * statistics of the traversal are added to @statistics. 
+  * With @aMinCost, only the trail cores of cost at least @aMinCost are 
+  * given to @process: the trail cores of a node all have the cost of the 
+  * node. 
+  */ 
+void traverse_K_TrailCoresTree(const TwoRoundTrailCoreCostFunction& costF, 
+                               unsigned int aMaxCost,
+                               const function<void(const TrailCore&)>& process, 
+                               TraversalStatistics* statistics = NULL, 
+                               unsigned int aMinCost = 0); 
 #endif
@@ -0,0 +1,160 @@
+/* perfCounters.cpp */
+#include <cstring>
+#include <iomanip>
+#include "perfCounters.h"
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+thread_local bool PerfCounters::enabled = false;
+bool PerfCounters::hardware = false;
+int PerfCounters::descriptors[PerfCounters::nrCounters] = {-1, -1, -1, -1};
+vector<PerfCounters::Phase> PerfCounters::phases;
+PerfCounters::Totals PerfCounters::totals[PerfCounters::nrPhases];
+chrono::steady_clock::time_point PerfCounters::lastTime;
+UINT64 PerfCounters::lastCounters[PerfCounters::nrCounters];
+
+PerfCounters::Totals::Totals(): entries(0), seconds(0)
+{
+    for (unsigned int i = 0; i < nrCounters; i++)
+        counters[i] = 0;
+}
+
+#ifdef __linux__
+static int openCounter(UINT64 config, int groupDescriptor)
+{
+    struct perf_event_attr attributes;
+    memset(&attributes, 0, sizeof(attributes));
+    attributes.type = PERF_TYPE_HARDWARE;
+    attributes.size = sizeof(attributes);
+    attributes.config = config;
+    attributes.disabled = (groupDescriptor == -1) ? 1 : 0;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    attributes.read_format = PERF_FORMAT_GROUP;
+    return syscall(__NR_perf_event_open, &attributes, 0, -1, groupDescriptor, 0);
+}
+#endif
+
+bool PerfCounters::start()
+{
+    stop();
+    for (unsigned int i = 0; i < nrPhases; i++)
+        totals[i] = Totals();
+    phases.clear();
+    hardware = false;
+#ifdef __linux__
+    const UINT64 configs[nrCounters] = {PERF_COUNT_HW_CPU_CYCLES,
+                                        PERF_COUNT_HW_INSTRUCTIONS,
+                                        PERF_COUNT_HW_CACHE_MISSES,
+                                        PERF_COUNT_HW_BRANCH_MISSES};
+    hardware = true;
+    for (unsigned int i = 0; i < nrCounters; i++) {
+        descriptors[i] = openCounter(configs[i], descriptors[0]);
+        if (descriptors[i] == -1)
+            hardware = false;
+    }
+    if (hardware) {
+        ioctl(descriptors[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        hardware = (ioctl(descriptors[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) == 0);
+    }
+    if (!hardware)
+        stop();
+#endif
+    for (unsigned int i = 0; i < nrCounters; i++)
+        lastCounters[i] = 0;
+    lastTime = chrono::steady_clock::now();
+    enabled = true;
+    sample();
+    return hardware;
+}
+
+void PerfCounters::stop()
+{
+    if (enabled)
+        sample();
+    enabled = false;
+#ifdef __linux__
+    for (unsigned int i = 0; i < nrCounters; i++) {
+        if (descriptors[i] != -1)
+            close(descriptors[i]);
+        descriptors[i] = -1;
+    }
+#endif
+}
+
+void PerfCounters::enter(Phase phase)
+{
+    sample();
+    phases.push_back(phase);
+    totals[phase].entries++;
+}
+
+void PerfCounters::leave()
+{
+    sample();
+    if (!phases.empty())
+        phases.pop_back();
+}
+
+void PerfCounters::sample()
+{
+    Phase current = phases.empty() ? other : phases.back();
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    totals[current].seconds += chrono::duration<double>(now - lastTime).count();
+    lastTime = now;
+#ifdef __linux__
+    if (hardware) {
+        UINT64 values[1 + nrCounters];
+        if (read(descriptors[0], values, sizeof(values)) == sizeof(values)) {
+            for (unsigned int i = 0; i < nrCounters; i++) {
+                totals[current].counters[i] += values[1 + i] - lastCounters[i];
+                lastCounters[i] = values[1 + i];
+            }
+        }
+    }
+#endif
+}
+
+const char* PerfCounters::getName(Phase phase)
+{
+    static const char* names[nrPhases] = {"other", "tree traversal", "input",
+        "state expansion", "forward extension", "backward extension",
+        "in-kernel extension", "output"};
+    return names[phase];
+}
+
+const PerfCounters::Totals& PerfCounters::getTotals(Phase phase)
+{
+    return totals[phase];
+}
+
+void PerfCounters::report(ostream& fout)
+{
+    if (enabled)
+        sample();
+    fout << left << setw(20) << "phase" << right << setw(12) << "entries" << setw(12) << "seconds";
+    if (hardware) {
+        fout << setw(16) << "cycles" << setw(16) << "instructions" << setw(8) << "IPC";
+        fout << setw(14) << "cache misses" << setw(14) << "branch misses";
+    }
+    fout << endl;
+    for (unsigned int i = 0; i < nrPhases; i++) {
+        const Totals& phase = totals[i];
+        fout << left << setw(20) << getName((Phase)i) << right << dec;
+        fout << setw(12) << phase.entries << setw(12) << fixed << setprecision(3) << phase.seconds;
+        if (hardware) {
+            double ipc = (phase.counters[cycles] > 0)
+                ? (double)phase.counters[instructions] / phase.counters[cycles] : 0;
+            fout << setw(16) << phase.counters[cycles] << setw(16) << phase.counters[instructions];
+            fout << setw(8) << setprecision(2) << ipc;
+            fout << setw(14) << phase.counters[cacheMisses] << setw(14) << phase.counters[branchMisses];
+        }
+        fout << defaultfloat << setprecision(6) << endl;
+    }
+    if (!hardware)
+        fout << "(hardware counters unavailable, time only)" << endl;
+}
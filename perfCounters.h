@@ -0,0 +1,128 @@
+/* perfCounters.h */
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+/*
+The classes of this file measure the number of cycles, instructions, cache
+misses and branch misses spent in the phases of the searches (the traversal
+of the trees, the expansion of the patterns into states, the extensions and
+the output), with the hardware counters of Linux (perf_event_open).
+
+The phases are delimited by PerfPhase objects. A phase started inside
+another one is subtracted from it, so the totals of the phases add up to
+the run. If the hardware counters are not available (eg other systems,
+containers or perf_event_paranoid), only the time spent in each phase is
+measured.
+
+The collector is off unless PerfCounters::start() is called, in which case
+changing phase costs a read of the counters, so the phases are placed
+around pieces of work such as the extension of a trail core rather than in
+the iterators. Only the thread that called start() is measured.
+*/
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include "types.h"
+
+class PerfCounters {
+    public:
+        enum Phase {
+            /** The time outside of any phase. */
+            other,
+            /** The traversal of the trees of 2-round trail cores. */
+            treeTraversal,
+            /** The reading of the trail cores to extend. */
+            input,
+            /** The expansion of the patterns into states (TroikaStateIterator). */
+            stateExpansion,
+            forwardExtension,
+            backwardExtension,
+            inKernelExtension,
+            /** The writing of the reports. The trail cores are written
+              * inside the phase that finds them. */
+            output,
+            nrPhases
+        };
+        enum Counter {
+            cycles,
+            instructions,
+            cacheMisses,
+            branchMisses,
+            nrCounters
+        };
+        /** The totals of a phase. */
+        class Totals {
+            public:
+                UINT64 entries;
+                double seconds;
+                UINT64 counters[nrCounters];
+            public:
+                Totals();
+        };
+    protected:
+        static thread_local bool enabled;
+        /** Whether the hardware counters could be opened. */
+        static bool hardware;
+        /** The file descriptors of the counters; the first one leads the group. */
+        static int descriptors[nrCounters];
+        static vector<Phase> phases;
+        static Totals totals[nrPhases];
+        static chrono::steady_clock::time_point lastTime;
+        static UINT64 lastCounters[nrCounters];
+    public:
+        /** It starts measuring the calling thread.
+          * @return True if the hardware counters are used, false if only
+          *         the time is measured.
+          */
+        static bool start();
+        /** It stops measuring and closes the counters. */
+        static void stop();
+        static bool isEnabled()
+        {
+            return enabled;
+        }
+        /** It indicates whether the hardware counters are used. */
+        static bool isHardware()
+        {
+            return hardware;
+        }
+        /** It starts the phase @a phase, inside the current one. */
+        static void enter(Phase phase);
+        /** It ends the current phase. */
+        static void leave();
+        static const char* getName(Phase phase);
+        /** It returns the totals of @a phase. */
+        static const Totals& getTotals(Phase phase);
+        /** It outputs the totals per phase as a table. */
+        static void report(ostream& fout);
+    protected:
+        /** It adds the time and the counts since the last sample to the
+          * current phase.
+          */
+        static void sample();
+};
+
+/** A phase that lasts from its construction to its destruction (or stop()). */
+class PerfPhase {
+    protected:
+        bool active;
+    public:
+        PerfPhase(PerfCounters::Phase phase): active(PerfCounters::isEnabled())
+        {
+            if (active)
+                PerfCounters::enter(phase);
+        }
+        ~PerfPhase()
+        {
+            stop();
+        }
+        void stop()
+        {
+            if (active)
+                PerfCounters::leave();
+            active = false;
+        }
+};
+
+#endif
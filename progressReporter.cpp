@@ -0,0 +1,160 @@
+/* progressReporter.cpp */
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sys/resource.h>
+#include "memoryAccounting.h"
+#include "progressReporter.h"
+
+ProgressReporter progress;
+
+thread_local ProgressReporter::LocalCounts ProgressReporter::localCounts;
+
+ProgressReporter::ProgressReporter(): active(false), generation(0), intervalSeconds(10), 
+    running(false)
+{
+    startPhase("");
+}
+
+ProgressReporter::~ProgressReporter()
+{
+    stop();
+}
+
+void ProgressReporter::start(const string& aStatusFileName, double anIntervalSeconds)
+{
+    stop();
+    statusFileName = aStatusFileName;
+    intervalSeconds = anIntervalSeconds;
+    running = true;
+    active.store(true, memory_order_relaxed);
+    reporter = thread(&ProgressReporter::run, this);
+}
+
+void ProgressReporter::stop()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        if (!running)
+            return;
+        running = false;
+    }
+    wakeUp.notify_all();
+    reporter.join();
+    publish();
+    active.store(false, memory_order_relaxed);
+    writeStatus();
+}
+
+bool ProgressReporter::isRunning()
+{
+    lock_guard<mutex> guard(lock);
+    return running;
+}
+
+void ProgressReporter::startPhase(const string& name)
+{
+    lock_guard<mutex> guard(lock);
+    phase = name;
+    phaseStart = chrono::steady_clock::now();
+    unsigned int newGeneration = generation.fetch_add(1, memory_order_relaxed) + 1;
+    // the counts of the calling thread not added yet belong to the previous phase
+    localCounts = LocalCounts();
+    localCounts.generation = newGeneration;
+    nodes.store(0, memory_order_relaxed);
+    for (unsigned int i = 0; i < PROGRESS_MAX_WEIGHT; i++)
+        trailsPerWeight[i].store(0, memory_order_relaxed);
+    prefixIndex.store(0, memory_order_relaxed);
+    prefixTotal.store(0, memory_order_relaxed);
+    fractionDone.store(-1, memory_order_relaxed);
+}
+
+void ProgressReporter::publish()
+{
+    LocalCounts& counts = localCounts;
+    // the counts of a thread that never added them are taken as counts of 
+    // the current phase
+    unsigned int currentGeneration = generation.load(memory_order_relaxed);
+    if ((counts.generation == 0) || (counts.generation == currentGeneration)) {
+        nodes.fetch_add(counts.nodes, memory_order_relaxed);
+        for (unsigned int i = 0; i < PROGRESS_MAX_WEIGHT; i++) {
+            if (counts.trailsPerWeight[i] > 0)
+                trailsPerWeight[i].fetch_add(counts.trailsPerWeight[i], memory_order_relaxed);
+        }
+    }
+    counts = LocalCounts();
+    counts.generation = currentGeneration;
+}
+
+void ProgressReporter::report(ostream& fout)
+{
+    string currentPhase;
+    double seconds;
+    {
+        lock_guard<mutex> guard(lock);
+        currentPhase = phase;
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - phaseStart).count();
+    }
+    UINT64 nrNodes = nodes.load(memory_order_relaxed);
+    UINT64 index = prefixIndex.load(memory_order_relaxed);
+    UINT64 total = prefixTotal.load(memory_order_relaxed);
+    double fraction = fractionDone.load(memory_order_relaxed);
+    if ((fraction < 0) && (total > 0) && (index > 0))
+        fraction = (double)(index - 1) / total;
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    fout << dec << "phase: " << currentPhase << endl;
+    fout << "elapsed: " << fixed << setprecision(1) << seconds << " s" << endl;
+    fout << "nodes: " << nrNodes << " (" << setprecision(0);
+    fout << ((seconds > 0) ? nrNodes / seconds : 0) << " per second)" << endl;
+    fout << "prefix: " << index << "/";
+    if (total > 0)
+        fout << total;
+    else
+        fout << "?";
+    fout << endl;
+    fout << "done: ";
+    if (fraction >= 0)
+        fout << setprecision(1) << 100 * fraction << "%";
+    else
+        fout << "?";
+    fout << endl;
+    fout << "trails per weight:";
+    for (unsigned int i = 0; i < PROGRESS_MAX_WEIGHT; i++) {
+        UINT64 count = trailsPerWeight[i].load(memory_order_relaxed);
+        if (count > 0)
+            fout << " " << i << ":" << count;
+    }
+    fout << endl;
+    fout << "peak RSS: " << usage.ru_maxrss / 1024 << " MB" << endl;
+    fout << defaultfloat << setprecision(6);
+    MemoryAccounting::report(fout);
+}
+
+void ProgressReporter::run()
+{
+    unique_lock<mutex> guard(lock);
+    while (running) {
+        wakeUp.wait_for(guard, chrono::duration<double>(intervalSeconds));
+        if (!running)
+            break;
+        guard.unlock();
+        writeStatus();
+        guard.lock();
+    }
+}
+
+void ProgressReporter::writeStatus()
+{
+    report(cerr);
+    if (statusFileName.empty())
+        return;
+    // the status file is replaced at once, so that it is never read half-written
+    string temporaryFileName = statusFileName + ".tmp";
+    {
+        ofstream fout(temporaryFileName.c_str());
+        report(fout);
+    }
+    rename(temporaryFileName.c_str(), statusFileName.c_str());
+}
@@ -0,0 +1,146 @@
+/* progressReporter.h */
+#ifndef PROGRESSREPORTER_H
+#define PROGRESSREPORTER_H
+
+/*
+The class of this file reports the progress of a long search: once started,
+a background thread periodically writes the number of nodes visited per
+second, the number of trails emitted per weight, the current prefix (the
+index of the first-level unit being traversed), the estimated fraction done
+and the peak resident set size to cerr and to a status file.
+
+The search counts the nodes and trails of each thread in thread-local
+counters, which are added to the shared atomic counters every
+PROGRESS_PUBLISH_PERIOD updates, so it is not slowed down by the reporter.
+Unless started, the reporter does not run any thread and the counters are
+not updated.
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "types.h"
+
+/** The number of weights for which the trails are counted; heavier trails
+  * are counted with the weight PROGRESS_MAX_WEIGHT - 1.
+  */
+#define PROGRESS_MAX_WEIGHT 128
+
+/** The number of updates of the counters of a thread between two additions
+  * to the shared counters. 
+  */
+#define PROGRESS_PUBLISH_PERIOD 1024
+
+class ProgressReporter {
+    protected:
+        /** The counts of a thread not yet added to the shared counters. It 
+          * is trivially constructible, so that the thread-local instance is 
+          * accessed without a guard. 
+          */
+        class LocalCounts {
+            public:
+                UINT64 nodes;
+                UINT64 trailsPerWeight[PROGRESS_MAX_WEIGHT];
+                /** The number of updates since the last addition. */
+                unsigned int nrUpdates;
+                /** The phase the counts belong to (see generation), or 0 
+                  * if the thread never added its counts. 
+                  */
+                unsigned int generation;
+        };
+        static thread_local LocalCounts localCounts;
+        /** True while the reporter thread runs. */
+        atomic<bool> active;
+        /** The number of phases started, from 1, to discard the counts of 
+          * a thread from a previous phase. 
+          */
+        atomic<unsigned int> generation;
+        /** The number of nodes visited since the start of the phase. */
+        atomic<UINT64> nodes;
+        /** The number of trails emitted per integer part of the weight. */
+        atomic<UINT64> trailsPerWeight[PROGRESS_MAX_WEIGHT];
+        /** The index (starting from 1) of the current first-level unit. */
+        atomic<UINT64> prefixIndex;
+        /** The number of first-level units, or 0 if unknown. */
+        atomic<UINT64> prefixTotal;
+        /** The fraction done, set explicitly, or negative if unknown. */
+        atomic<double> fractionDone;
+        /** The name of the current phase, protected by mutex. */
+        string phase;
+        chrono::steady_clock::time_point phaseStart;
+        string statusFileName;
+        double intervalSeconds;
+        bool running;
+        thread reporter;
+        mutex lock;
+        condition_variable wakeUp;
+    public:
+        ProgressReporter();
+        /** It stops the reporter thread, if any. */
+        ~ProgressReporter();
+        /** It starts the reporter thread.
+          * @param  aStatusFileName  The file overwritten at each report.
+          * @param  anIntervalSeconds  The time between two reports.
+          */
+        void start(const string& aStatusFileName, double anIntervalSeconds = 10);
+        /** It writes a last report and stops the reporter thread. */
+        void stop();
+        /** It indicates whether the reporter thread runs. */
+        bool isRunning();
+        /** It starts a new phase of the search (eg KN_FromInKernelExtension):
+          * the counters and the clock are reset.
+          */
+        void startPhase(const string& name);
+        /** It counts @a count nodes visited. */
+        void addNodes(UINT64 count = 1)
+        {
+            if (!active.load(memory_order_relaxed))
+                return;
+            localCounts.nodes += count;
+            if (++localCounts.nrUpdates >= PROGRESS_PUBLISH_PERIOD)
+                publish();
+        }
+        /** It counts a trail emitted with weight @a weight. */
+        void addTrail(const Weight& weight)
+        {
+            if (!active.load(memory_order_relaxed))
+                return;
+            unsigned int bin = min<unsigned int>(weight.integer + (unsigned int)(LOG * weight.logPart),
+                                                 PROGRESS_MAX_WEIGHT - 1);
+            localCounts.trailsPerWeight[bin]++;
+            if (++localCounts.nrUpdates >= PROGRESS_PUBLISH_PERIOD)
+                publish();
+        }
+        /** It adds the counts of the calling thread to the shared counters. */
+        void publish();
+        /** It sets the number of first-level units of the tree traversed. */
+        void setNrFirstLevelUnits(UINT64 total)
+        {
+            prefixTotal.store(total, memory_order_relaxed);
+        }
+        /** It sets the index (starting from 1) of the current first-level unit. */
+        void setPrefix(UINT64 index)
+        {
+            prefixIndex.store(index, memory_order_relaxed);
+        }
+        /** It sets the fraction done when it is known otherwise than from the
+          * prefix (eg from the position in an input file).
+          */
+        void setFractionDone(double fraction)
+        {
+            fractionDone.store(fraction, memory_order_relaxed);
+        }
+        /** It writes the current progress on @a fout. */
+        void report(ostream& fout);
+    protected:
+        void run();
+        void writeStatus();
+};
+
+/** The reporter used by the searches. */
+extern ProgressReporter progress;
+
+#endif
@@ -59,9 +59,27 @@ bool Sbox::init()
     Sbox::DDTInitialization(); 
     Sbox::outputInputDiffInitialization(); 
     Sbox::inKernelTryteColumnBeforeSTInitialization(); 
+    MemoryAccounting::allocate(memorySboxTables, getTablesSize()); 
     return true; 
 }
 
+size_t Sbox::getTablesSize()
+{
+    size_t size = 0; 
+    for (unsigned int i = 0; i < 27; i++) {
+        size += outputDiff[i].capacity() * sizeof(TryteSTCompatible); 
+        size += inputDiff[i].capacity() * sizeof(TryteSTCompatible); 
+    }
+    for (unsigned int i = 0; i < inKernelTryteColumnBeforeST.size(); i++) {
+        for (unsigned int j = 0; j < inKernelTryteColumnBeforeST[i].size(); j++) {
+            for (unsigned int k = 0; k < inKernelTryteColumnBeforeST[i][j].size(); k++)
+                size += inKernelTryteColumnBeforeST[i][j][k].capacity() 
+                        * sizeof(TryteColumnSTCompatible); 
+        }
+    }
+    return size; 
+}
+
 bool Sbox::areSTCompatible(const TroikaState& inputDifference, 
                            const TroikaState& outputDifference, 
                            const vector<TrytePosition>& positionsForSTCompatibility,
@@ -20,6 +20,7 @@ valid or not and to know the weight of a valid differential over Subtrytes.
 #include <iostream>
 #include <algorithm>
 #include <assert.h>
+#include "memoryAccounting.h"
 #include "state.h"
 
 /** Class used to store an input (resp. output) tryte difference compatible with 
@@ -155,6 +156,12 @@ class Sbox
         bool areSTCompatible(const TroikaState &inputDifference, 
                              const TroikaState &outputDifference,
                              Weight &weightToSet) const;
+        /** It checks wether an input tryte difference is compatible with an 
+          * output tryte difference by the S-box. If that is the case, it adds
+          * the weight of the transition to @a accumulatedWeight. 
+          */ 
+        bool areSTCompatible(Tryte inputTryte, Tryte outputTryte, 
+                             Weight &accumulatedWeight) const;
         void displayDDT() const; 
         void displayOutputCompatibleWith(const Tryte &input) const; 
         void displayInputCompatibleWith(const Tryte &output) const; 
@@ -168,7 +175,7 @@ class Sbox
                                                                 unsigned j, 
                                                                 unsigned k);
         static void inKernelTryteColumnBeforeSTInitialization();
-        bool areSTCompatible(Tryte inputTryte, Tryte outputTryte, 
-                             Weight &accumulatedWeight) const;
+        /** It returns the number of bytes allocated for the tables. */
+        static size_t getTablesSize();
 }; 
 #endif
@@ -0,0 +1,48 @@
+/* searchPhase.h */
+#ifndef SEARCHPHASE_H
+#define SEARCHPHASE_H
+
+/*
+The classes of this file delimit the phases of the searches for all the
+instruments at once: the progress reporter (progressReporter.h), the trace
+(trace.h) and the hardware counters (perfCounters.h). A SearchPhase is a
+phase of a driver, such as KN_FromForwardExtension; a SearchStep is a piece
+of work inside it, such as the preparation or the enumeration of the
+extensions of a trail core.
+*/
+
+#include "perfCounters.h"
+#include "progressReporter.h"
+#include "trace.h"
+
+/** A step that lasts from its construction to its destruction (or stop()),
+  * recorded as a nested span of the trace and as a phase of the counters.
+  */
+class SearchStep {
+    protected:
+        TraceSpan span;
+        PerfPhase perfPhase;
+    public:
+        /** @param  aName  The name of the span, which must be a string literal. */
+        SearchStep(const char* aName, PerfCounters::Phase aPhase,
+                   TraceSpan::Kind kind = TraceSpan::nested):
+            span(aName, kind), perfPhase(aPhase) {}
+        /** It ends the step before its destruction. */
+        void stop()
+        {
+            span.stop();
+            perfPhase.stop();
+        }
+};
+
+/** A phase of a driver: it also starts a new phase of the progress reporter,
+  * and it is always recorded in the trace.
+  */
+class SearchPhase : public SearchStep {
+    public:
+        /** @param  aName  The name of the phase, which must be a string literal. */
+        SearchPhase(const char* aName, PerfCounters::Phase aPhase):
+            SearchStep((progress.startPhase(aName), aName), aPhase, TraceSpan::phase) {}
+};
+
+#endif
@@ -0,0 +1,237 @@
+/* smallVector.h */
+#ifndef SMALLVECTOR_H
+#define SMALLVECTOR_H
+
+/*
+The class of this file is used to store a small number of elements (eg the
+differences of a trail core) without allocating memory on the heap.
+*/
+
+#include <vector>
+#include <new>
+#include <utility>
+#include "types.h"
+
+/** A vector-like container which stores up to N elements in an inline
+  * buffer. If more than N elements are stored, the elements are moved to the
+  * heap, so the capacity is not bounded. Only the subset of the interface of
+  * std::vector used by the trail cores is provided.
+  */
+template<class T, unsigned int N>
+class SmallVector
+{
+    protected:
+        /** The inline buffer, used as long as capacity == N. */
+        alignas(T) unsigned char inlineBuffer[N * sizeof(T)];
+        /** Pointer to the elements, either inlineBuffer or a heap block. */
+        T* elements;
+        /** The number of elements stored. */
+        unsigned int count;
+        /** The number of elements that can be stored without reallocating. */
+        unsigned int capacity;
+    public:
+        typedef T* iterator;
+        typedef const T* const_iterator;
+    public:
+        SmallVector(): elements(inlineElements()), count(0), capacity(N) {}
+
+        SmallVector(const SmallVector& other):
+            elements(inlineElements()), count(0), capacity(N)
+        {
+            reserve(other.count);
+            for (unsigned int i = 0; i < other.count; i++)
+                new (elements + i) T(other.elements[i]);
+            count = other.count;
+        }
+
+        /** The heap block of @a other, if any, is taken over; an inline
+          * buffer is copied element by element.
+          */
+        SmallVector(SmallVector&& other):
+            elements(inlineElements()), count(0), capacity(N)
+        {
+            takeOver(other);
+        }
+
+        SmallVector(const vector<T>& other):
+            elements(inlineElements()), count(0), capacity(N)
+        {
+            reserve(other.size());
+            for (unsigned int i = 0; i < other.size(); i++)
+                new (elements + i) T(other[i]);
+            count = other.size();
+        }
+
+        ~SmallVector()
+        {
+            clear();
+            releaseHeap();
+        }
+
+        SmallVector& operator = (const SmallVector& other)
+        {
+            if (this != &other) {
+                clear();
+                reserve(other.count);
+                for (unsigned int i = 0; i < other.count; i++)
+                    new (elements + i) T(other.elements[i]);
+                count = other.count;
+            }
+            return *this;
+        }
+
+        SmallVector& operator = (SmallVector&& other)
+        {
+            if (this != &other) {
+                clear();
+                releaseHeap();
+                takeOver(other);
+            }
+            return *this;
+        }
+
+        unsigned int size() const { return count; }
+        bool empty() const { return (count == 0); }
+        /** It indicates whether the elements are stored in the inline buffer. */
+        bool isInline() const { return (elements == inlineElements()); }
+
+        T& operator [] (unsigned int i) { return elements[i]; }
+        const T& operator [] (unsigned int i) const { return elements[i]; }
+        T& front() { return elements[0]; }
+        const T& front() const { return elements[0]; }
+        T& back() { return elements[count - 1]; }
+        const T& back() const { return elements[count - 1]; }
+
+        iterator begin() { return elements; }
+        iterator end() { return elements + count; }
+        const_iterator begin() const { return elements; }
+        const_iterator end() const { return elements + count; }
+
+        void push_back(const T& value)
+        {
+            if (count == capacity) {
+                // value may be an element of this vector
+                T copy(value);
+                reserve(2 * capacity);
+                new (elements + count) T(std::move(copy));
+            } else {
+                new (elements + count) T(value);
+            }
+            count++;
+        }
+
+        void pop_back()
+        {
+            assert(count > 0);
+            count--;
+            elements[count].~T();
+        }
+
+        /** It inserts @a value before @a position, by shifting the following
+          * elements.
+          */
+        iterator insert(iterator position, const T& value)
+        {
+            unsigned int index = position - elements;
+            assert(index <= count);
+            T copy(value);
+            if (count == capacity)
+                reserve(2 * capacity);
+            if (index == count) {
+                new (elements + count) T(std::move(copy));
+            } else {
+                new (elements + count) T(std::move(elements[count - 1]));
+                for (unsigned int i = count - 1; i > index; i--)
+                    elements[i] = std::move(elements[i - 1]);
+                elements[index] = std::move(copy);
+            }
+            count++;
+            return elements + index;
+        }
+
+        /** It removes the element at @a position, by shifting the following
+          * elements.
+          */
+        iterator erase(iterator position)
+        {
+            unsigned int index = position - elements;
+            assert(index < count);
+            for (unsigned int i = index; i + 1 < count; i++)
+                elements[i] = std::move(elements[i + 1]);
+            pop_back();
+            return elements + index;
+        }
+
+        void resize(unsigned int newSize)
+        {
+            reserve(newSize);
+            while (count < newSize) {
+                new (elements + count) T();
+                count++;
+            }
+            while (count > newSize)
+                pop_back();
+        }
+
+        void clear()
+        {
+            while (count > 0)
+                pop_back();
+        }
+
+        void reserve(unsigned int newCapacity)
+        {
+            if (newCapacity <= capacity)
+                return;
+            T* newElements = static_cast<T*>(::operator new(newCapacity * sizeof(T)));
+            for (unsigned int i = 0; i < count; i++) {
+                new (newElements + i) T(std::move(elements[i]));
+                elements[i].~T();
+            }
+            releaseHeap();
+            elements = newElements;
+            capacity = newCapacity;
+        }
+
+    protected:
+        T* inlineElements()
+        {
+            return reinterpret_cast<T*>(inlineBuffer);
+        }
+
+        const T* inlineElements() const
+        {
+            return reinterpret_cast<const T*>(inlineBuffer);
+        }
+
+        /** It frees the heap block, if any. The elements must be destroyed. */
+        void releaseHeap()
+        {
+            if (!isInline())
+                ::operator delete(elements);
+            elements = inlineElements();
+            capacity = N;
+        }
+
+        /** It moves the elements of @a other into this empty vector and
+          * leaves @a other empty.
+          */
+        void takeOver(SmallVector& other)
+        {
+            if (other.isInline()) {
+                for (unsigned int i = 0; i < other.count; i++)
+                    new (elements + i) T(std::move(other.elements[i]));
+                count = other.count;
+                other.clear();
+            } else {
+                elements = other.elements;
+                count = other.count;
+                capacity = other.capacity;
+                other.elements = other.inlineElements();
+                other.count = 0;
+                other.capacity = N;
+            }
+        }
+};
+
+#endif
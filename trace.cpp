@@ -0,0 +1,79 @@
+/* trace.cpp */
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include "trace.h"
+
+atomic<bool> Tracer::enabled(false);
+chrono::steady_clock::time_point Tracer::origin;
+string Tracer::fileName;
+unsigned int Tracer::samplingPeriod = 1;
+unsigned int Tracer::bufferCapacity = 1 << 16;
+mutex Tracer::lock;
+vector<TraceBuffer*> Tracer::buffers;
+
+TraceBuffer::TraceBuffer(unsigned int aThreadIndex, unsigned int capacity):
+    threadIndex(aThreadIndex), events(capacity), nrRecorded(0), skipping(false),
+    nrSamplingSpans(0)
+{
+}
+
+void Tracer::start(const string& aFileName, unsigned int aSamplingPeriod,
+                   unsigned int aBufferCapacity)
+{
+    lock_guard<mutex> guard(lock);
+    if (enabled)
+        throw Exception("The tracer is already started.");
+    fileName = aFileName;
+    samplingPeriod = max(1U, aSamplingPeriod);
+    bufferCapacity = max(1U, aBufferCapacity);
+    origin = chrono::steady_clock::now();
+    atexit(save);
+    enabled = true;
+}
+
+TraceBuffer& Tracer::getBuffer()
+{
+    static thread_local TraceBuffer* buffer = NULL;
+    if (buffer == NULL) {
+        lock_guard<mutex> guard(lock);
+        buffer = new TraceBuffer(buffers.size(), bufferCapacity);
+        buffers.push_back(buffer);
+    }
+    return *buffer;
+}
+
+void Tracer::save()
+{
+    lock_guard<mutex> guard(lock);
+    if (!enabled)
+        return;
+    enabled = false;
+    ofstream fout(fileName.c_str());
+    if (!fout) {
+        cerr << "The trace cannot be written in '" << fileName << "'." << endl;
+        return;
+    }
+    // the times are in microseconds with the nanoseconds as decimals: the 
+    // default precision of 6 digits would round them after 1 s
+    fout << fixed << setprecision(3);
+    fout << "{\"traceEvents\": [" << endl;
+    bool first = true;
+    for (unsigned int i = 0; i < buffers.size(); i++) {
+        const TraceBuffer& buffer = *buffers[i];
+        UINT64 capacity = buffer.events.size();
+        UINT64 begin = (buffer.nrRecorded > capacity) ? buffer.nrRecorded - capacity : 0;
+        for (UINT64 j = begin; j < buffer.nrRecorded; j++) {
+            const TraceEvent& event = buffer.events[j % capacity];
+            if (!first)
+                fout << "," << endl;
+            first = false;
+            fout << "{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 1";
+            fout << ", \"tid\": " << dec << buffer.threadIndex;
+            fout << ", \"ts\": " << event.start / 1000.0;
+            fout << ", \"dur\": " << event.duration / 1000.0 << "}";
+        }
+    }
+    fout << endl << "], \"displayTimeUnit\": \"ms\"}" << endl;
+}
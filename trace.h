@@ -0,0 +1,158 @@
+/* trace.h */
+#ifndef TRACE_H
+#define TRACE_H
+
+/*
+The classes of this file record the duration of the phases of the searches
+(eg the preparation of the extensions, their enumeration or the writing of
+the reports) as spans on a timeline, which is saved in the Chrome trace event
+format and can be opened with chrome://tracing or https://ui.perfetto.dev.
+
+Each thread records its spans in its own ring buffer, so that the memory used
+is bounded and that the threads do not synchronize. When the buffer of a thread
+is full, its oldest spans are overwritten.
+
+Tracing is off unless Tracer::start() is called, in which case a span costs
+a test of a boolean. To keep tracing on during long runs, the spans of a unit
+of work (eg a trail core to extend) are sampled: only one out of
+samplingPeriod sampling spans is recorded, with the spans nested inside it.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "types.h"
+
+/** A span recorded by a thread. The times are in nanoseconds since the start
+  * of the tracer.
+  */
+class TraceEvent {
+    public:
+        /** The name of the span, which must be a string literal. */
+        const char* name;
+        UINT64 start;
+        UINT64 duration;
+};
+
+/** The ring buffer of the spans recorded by a thread. */
+class TraceBuffer {
+    public:
+        /** The index of the thread in the trace. */
+        unsigned int threadIndex;
+        vector<TraceEvent> events;
+        /** The number of spans recorded, including the overwritten ones. */
+        UINT64 nrRecorded;
+        /** It indicates whether a sampling span that is not recorded is
+          * running, in which case the spans nested inside it are not recorded.
+          */
+        bool skipping;
+        /** The number of sampling spans met, to choose the recorded ones. */
+        UINT64 nrSamplingSpans;
+    public:
+        TraceBuffer(unsigned int aThreadIndex, unsigned int capacity);
+        void record(const char* name, UINT64 start, UINT64 duration)
+        {
+            TraceEvent& event = events[nrRecorded % events.size()];
+            event.name = name;
+            event.start = start;
+            event.duration = duration;
+            nrRecorded++;
+        }
+};
+
+class Tracer {
+    protected:
+        static atomic<bool> enabled;
+        static chrono::steady_clock::time_point origin;
+        static string fileName;
+        static unsigned int samplingPeriod;
+        static unsigned int bufferCapacity;
+        static mutex lock;
+        /** The buffers of all the threads, kept after the threads end. */
+        static vector<TraceBuffer*> buffers;
+    public:
+        /** It starts tracing; the trace is saved in @a aFileName at exit.
+          * @param  aFileName  The name of the JSON file.
+          * @param  aSamplingPeriod  One sampling span out of aSamplingPeriod
+          *                   is recorded (1 to record all of them).
+          * @param  aBufferCapacity  The number of spans kept per thread.
+          */
+        static void start(const string& aFileName, unsigned int aSamplingPeriod = 1,
+                          unsigned int aBufferCapacity = 1 << 16);
+        static bool isEnabled()
+        {
+            return enabled.load(memory_order_relaxed);
+        }
+        /** It returns the time in nanoseconds since the start of the tracer. */
+        static UINT64 now()
+        {
+            return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - origin).count();
+        }
+        /** It returns the buffer of the calling thread. */
+        static TraceBuffer& getBuffer();
+        /** It indicates whether the sampling span that starts is recorded. */
+        static bool sample(TraceBuffer& buffer)
+        {
+            return (buffer.nrSamplingSpans++ % samplingPeriod) == 0;
+        }
+        /** It writes the spans of all the threads in the file, in the Chrome
+          * trace event format. It is called at exit.
+          */
+        static void save();
+};
+
+/** A span that lasts from its construction to its destruction. */
+class TraceSpan {
+    public:
+        enum Kind {
+            /** A phase of a search, always recorded. */
+            phase,
+            /** A unit of work repeated many times, recorded if sampled. */
+            sampling,
+            /** A span recorded if the enclosing sampling span is recorded,
+              * or if there is no enclosing sampling span. */
+            nested
+        };
+    protected:
+        const char* name;
+        /** The buffer where the span is recorded, or NULL. */
+        TraceBuffer* buffer;
+        /** The buffer whose skipping flag this span set, or NULL. */
+        TraceBuffer* skipped;
+        UINT64 start;
+    public:
+        /** @param  aName  The name of the span, which must be a string literal. */
+        TraceSpan(const char* aName, Kind kind = nested): name(aName), buffer(NULL), skipped(NULL)
+        {
+            if (!Tracer::isEnabled())
+                return;
+            TraceBuffer& threadBuffer = Tracer::getBuffer();
+            if (threadBuffer.skipping && kind != phase)
+                return;
+            if (kind == sampling && !Tracer::sample(threadBuffer)) {
+                threadBuffer.skipping = true;
+                skipped = &threadBuffer;
+                return;
+            }
+            buffer = &threadBuffer;
+            start = Tracer::now();
+        }
+        ~TraceSpan()
+        {
+            stop();
+        }
+        /** It ends the span before its destruction. */
+        void stop()
+        {
+            if (skipped != NULL)
+                skipped->skipping = false;
+            if (buffer != NULL)
+                buffer->record(name, start, Tracer::now() - start);
+            skipped = NULL;
+            buffer = NULL;
+        }
+};
+
+#endif
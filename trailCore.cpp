@@ -4,6 +4,8 @@
 #include "forwardExtension.h"
 #include "backwardExtension.h"
 
+bool TrailCore::compactStorage = false; 
+
 TrailCore::TrailCore(const vector<TroikaState>& differences, Weight wMinRev, 
                      Weight wMinDir, const vector<Weight> weights): 
 nrRounds(differences.size() / 2 + 1), differences(differences),
@@ -57,6 +59,11 @@ void TrailCore::clear()
 void TrailCore::load(istream &fin)
 { 
     fin >> hex;  
+    fin >> ws; 
+    // the marker is not a hexadecimal digit, unlike the number of rounds
+    bool compact = (fin.peek() == '#'); 
+    if (compact)
+        fin.get(); 
     fin >> nrRounds;
     if (nrRounds < 2 || fin.eof()) { 
         throw Exception();
@@ -76,14 +83,24 @@ void TrailCore::load(istream &fin)
     weight += wMinDir; 
 
     differences.resize(2*(nrRounds - 1));
-    for (unsigned int i = 0; i < 2*(nrRounds - 1); i++)
-        differences[i].load(fin); 
+    if (compact) {
+        for (unsigned int i = 0; i < nrRounds - 1; i++) {
+            differences[2 * i].load(fin); 
+            differences[2 * i + 1] = differences[2 * i];
+            differences[2 * i + 1].L();
+        }
+    } else {
+        for (unsigned int i = 0; i < 2*(nrRounds - 1); i++)
+            differences[i].load(fin); 
+    }
 }
 
 void TrailCore::save(ostream &fout) const
 {
-    vector<TroikaState>::const_iterator it; 
+    SmallVector<TroikaState, 2 * (TRAILCORE_INLINE_ROUNDS - 1)>::const_iterator it; 
     fout << hex;
+    if (compactStorage)
+        fout << "# "; 
     fout << nrRounds << " "; 
     fout << wMinRev.integer << " ";  
     fout << wMinRev.logPart << " ";  
@@ -93,8 +110,13 @@ void TrailCore::save(ostream &fout) const
     }
     fout << wMinDir.integer << " "; 
     fout << wMinDir.logPart << " "; 
-    for (it = differences.begin(); it != differences.end(); it++) 
-        (*it).save(fout);
+    if (compactStorage) {
+        for (unsigned int i = 0; i < nrRounds - 1; i++) 
+            differences[2 * i].save(fout);
+    } else {
+        for (it = differences.begin(); it != differences.end(); it++) 
+            (*it).save(fout);
+    }
     fout << endl; 
 }
 
@@ -124,6 +146,36 @@ void TrailCore::extendBackward(const BackwardExtension &extension)
     wMinRev = extension.wMinRevA; 
 }
 
+void TrailCore::retractForward()
+{
+    if (nrRounds < 3)
+        throw Exception("The trail core has not been extended. It cannot be retracted");
+
+    nrRounds -= 1; 
+    Weight wBC = weights.back(); 
+    differences.pop_back(); 
+    differences.pop_back(); 
+    weights.pop_back(); 
+    Weight previousWMinDir(2 * differences.back().getNrActiveTrytes()); 
+    weight = weight - wMinDir - wBC + previousWMinDir; 
+    wMinDir = previousWMinDir; 
+}
+
+void TrailCore::retractBackward()
+{
+    if (nrRounds < 3)
+        throw Exception("The trail core has not been extended. It cannot be retracted");
+
+    nrRounds -= 1; 
+    Weight wBC = weights[0]; 
+    differences.erase(differences.begin()); 
+    differences.erase(differences.begin()); 
+    weights.erase(weights.begin()); 
+    Weight previousWMinRev(2 * differences[0].getNrActiveTrytes()); 
+    weight = weight - wMinRev - wBC + previousWMinRev; 
+    wMinRev = previousWMinRev; 
+}
+
 void TrailCore::checkTrailCore(const Sbox &sbox) const
 { 
     // Check the size of the vectors differences and weights 
@@ -213,7 +265,7 @@ void TrailCore::makeCanonical()
 
 void TrailCore::translate(unsigned int dz)
 {
-    for (vector<TroikaState>::iterator it = differences.begin(); 
+    for (SmallVector<TroikaState, 2 * (TRAILCORE_INLINE_ROUNDS - 1)>::iterator it = differences.begin(); 
          it != differences.end(); it++) {
         (*it).translate(dz);
     }
@@ -238,11 +290,72 @@ ostream & operator << (ostream &fout, const TrailCore &aTrailCore)
     return fout;
 }
 
+bool LowestWeightTrailCores::add(const TrailCore& trail)
+{
+    if (k == 0)
+        return false; 
+    if (isFull() && (trail.weight > getLargestWeight()))
+        return false; 
+    TrailCore canonical(trail); 
+    canonical.makeCanonical(); 
+    if (!trails.insert(canonical).second)
+        return false; 
+    bool kept = true; 
+    if (trails.size() > k) {
+        kept = (LighterTrailCore()(canonical, *trails.rbegin())); 
+        trails.erase(prev(trails.end())); 
+    }
+    lowerSharedBound(); 
+    return kept; 
+}
+
+void LowestWeightTrailCores::lowerSharedBound()
+{
+    if ((sharedBound == NULL) || !isFull() || trails.empty())
+        return; 
+    long long largest = getLargestWeight().fixedPoint(); 
+    long long current = sharedBound->load(memory_order_relaxed); 
+    while ((largest < current) 
+           && !sharedBound->compare_exchange_weak(current, largest, memory_order_relaxed)); 
+}
+
+void LowestWeightTrailCores::add(const LowestWeightTrailCores& other)
+{
+    for (auto it = other.trails.begin(); it != other.trails.end(); it++)
+        add(*it); 
+}
+
+void LowestWeightTrailCores::shareBound(atomic<long long>* aSharedBound)
+{
+    sharedBound = aSharedBound; 
+    lowerSharedBound(); 
+}
+
+void LowestWeightTrailCores::lowerBound(WeightBound& bound) const
+{
+    if (isFull() && !trails.empty() && (WeightBound(getLargestWeight()) < bound))
+        bound = WeightBound(getLargestWeight()); 
+    if (sharedBound != NULL) {
+        long long shared = sharedBound->load(memory_order_relaxed); 
+        if (shared < bound.scaled)
+            bound.scaled = shared; 
+    }
+}
+
+void LowestWeightTrailCores::save(ostream& fout) const
+{
+    for (auto it = trails.begin(); it != trails.end(); it++)
+        (*it).save(fout); 
+}
+
 TrailFileIterator::TrailFileIterator(const string& fileName):fin(fileName)
 {
     
     if (!fin) 
         throw Exception((string)"File '" + fileName + (string)"' cannot be read." ); 
+    fin.seekg(0, ios::end);
+    fileSize = fin.tellg();
+    fin.seekg(0, ios::beg);
     end = false; 
     ++(*this);  
 }
@@ -266,6 +379,13 @@ bool TrailFileIterator::isEnd() const
     return end; 
 }
 
+double TrailFileIterator::getFractionRead()
+{
+    if (end || fileSize <= 0)
+        return 1.0; 
+    return (double)fin.tellg() / fileSize; 
+}
+
 void produceHumanReadableFile(const string& fileName,
                               bool verbose, 
                               double time)
@@ -13,13 +13,25 @@ The classes of this file are used to store trail cores, to verify their
 consistency, to save them in a file and read them from a file. 
 */
 
+#include <atomic>
 #include <vector>
 #include <fstream>
 #include <iostream>
 #include <cmath>
+#include <set>
+#include "memoryAccounting.h"
 #include "types.h"
 #include "state.h"
 #include "sbox.h"
+#include "smallVector.h"
+
+/** The number of rounds up to which the differences and the weights of a 
+  * trail core are stored without allocating memory on the heap. It covers
+  * the 3-round trail cores kept in the sets of trail cores: each round more
+  * adds two states (432 bytes) to every trail core stored. A longer trail 
+  * core moves to the heap, once for an in-place extension. 
+  */
+#define TRAILCORE_INLINE_ROUNDS 3
 
 class ForwardExtension;
 class BackwardExtension;
@@ -41,7 +53,7 @@ class TrailCore
           * differences[0] --L --> differences[1]--ST--> differences[2]
           * ...  --L-> differences.back()
           */
-        vector<TroikaState> differences; 
+        SmallVector<TroikaState, 2 * (TRAILCORE_INLINE_ROUNDS - 1)> differences; 
         /** Minimum reverse weight of the state differences[0] */
         Weight wMinRev;
         /** Minimum weight of the state differences.back() */
@@ -51,9 +63,17 @@ class TrailCore
           * minimum reverse weight of differences[0] and the minimum
           * weight of differences.back() ). 
           */
-        vector<Weight> weights;
+        SmallVector<Weight, TRAILCORE_INLINE_ROUNDS - 2> weights;
         /** Total weight of the trail core. */
         Weight weight;
+        /** If true, save() writes the trail cores in the compact format: 
+          * only the states differences[2i] are written, since 
+          * differences[2i + 1] = Lambda(differences[2i]) is recomputed by 
+          * load(). Such a line starts with the marker '#', which cannot be 
+          * read as the hexadecimal number of rounds of a line in the full 
+          * format. load() reads both formats. 
+          */
+        static bool compactStorage; 
     public: 
         TrailCore():nrRounds(0), wMinRev(0), wMinDir(0), weight(0){}
         TrailCore(const vector<TroikaState>& differences, 
@@ -64,6 +84,9 @@ class TrailCore
         TrailCore(const TrailCore& other): nrRounds(other.nrRounds),
          differences(other.differences), wMinRev(other.wMinRev),
          wMinDir(other.wMinDir), weights(other.weights), weight(other.weight){}
+        TrailCore(TrailCore&& other) = default; 
+        TrailCore& operator = (const TrailCore& other) = default; 
+        TrailCore& operator = (TrailCore&& other) = default; 
         /** Constructor for a 2-round trail core A --Lambda--> B */ 
         TrailCore(const TroikaState& stateA, const TroikaState& stateB, 
                   Weight wMinRevA, Weight wMinDirB);
@@ -85,11 +108,27 @@ class TrailCore
         /** Same as above but with a forward extension. */ 
         TrailCore(const TrailCore& trailToExtend, const ForwardExtension& extension)
         :TrailCore(trailToExtend) {extendForward(extension);}
+        /** Same as above but the trail core to extend is moved instead of 
+          * being copied. 
+          */
+        TrailCore(TrailCore&& trailToExtend, const BackwardExtension& extension)
+        :TrailCore(std::move(trailToExtend)) {extendBackward(extension);}
+        /** Same as above but with a forward extension. */ 
+        TrailCore(TrailCore&& trailToExtend, const ForwardExtension& extension)
+        :TrailCore(std::move(trailToExtend)) {extendForward(extension);}
         void clear(); 
         void load(istream& fin);
         void save(ostream& fout) const;
         void extendForward(const ForwardExtension& extension);
         void extendBackward(const BackwardExtension& extension);
+        /** It undoes the last call to extendForward(), ie it removes the
+          * last round of the trail core. 
+          */
+        void retractForward(); 
+        /** It undoes the last call to extendBackward(), ie it removes the
+          * first round of the trail core. 
+          */
+        void retractBackward();
         /** This method checks the consistency of the trail core.
           * If an inconsistency is found, an Exception is thrown and details
           * about the inconsistency are displayed in the error console (cerr).
@@ -111,6 +150,99 @@ class TrailCore
         friend ostream & operator << (ostream &fout, const TrailCore& aTrailCore);
 };
 
+/** Order relation used by LowestWeightTrailCores: by weight, then by the 
+  * order relation of the trail cores. 
+  */
+class LighterTrailCore {
+    public: 
+        bool operator () (const TrailCore& first, const TrailCore& second) const
+        {
+            if (first.weight != second.weight)
+                return first.weight < second.weight; 
+            return first < second; 
+        }
+};
+
+/** Class used to keep the k trail cores of lowest weight among the trail 
+  * cores added to it. The trail cores are made canonical, so that a trail 
+  * core and its translations are kept once. Several sets (eg one per thread)
+  * can share a bound: the lowest k-th weight of the full sets. 
+  */
+class LowestWeightTrailCores
+{
+    protected: 
+        /** The maximum number of trail cores kept. */ 
+        unsigned int k; 
+        set<TrailCore, LighterTrailCore, 
+            AccountedAllocator<TrailCore, memoryTrailSets>> trails; 
+        /** The shared bound as a fixed-point key (see Weight::fixedPoint()), 
+          * or NULL. 
+          */ 
+        atomic<long long>* sharedBound; 
+    public: 
+        LowestWeightTrailCores(unsigned int aK): k(aK), sharedBound(NULL) {}
+        /** It adds @a trail if it is among the k lightest trail cores.
+          * @return True if the trail core is kept. 
+          */ 
+        bool add(const TrailCore& trail); 
+        /** It indicates whether k trail cores are kept. */ 
+        bool isFull() const
+        {
+            return trails.size() >= k; 
+        }
+        /** It returns the number of trail cores kept. */ 
+        unsigned int size() const
+        {
+            return trails.size(); 
+        }
+        /** It returns the weight of the heaviest trail core kept, ie the 
+          * k-th weight if isFull(). The set must not be empty. 
+          */ 
+        Weight getLargestWeight() const
+        {
+            return trails.rbegin()->weight; 
+        }
+        /** It adds the trail cores kept by @a other. */ 
+        void add(const LowestWeightTrailCores& other); 
+        /** It makes this set lower @a aSharedBound to its k-th weight when 
+          * it is full, and use it in lowerBound(). 
+          */ 
+        void shareBound(atomic<long long>* aSharedBound); 
+        /** It lowers @a bound to the k-th weight if this set is full, and to
+          * the shared bound, if any. 
+          */ 
+        void lowerBound(WeightBound& bound) const; 
+        /** It saves the trail cores kept in ascending order of weight. */ 
+        void save(ostream& fout) const; 
+    protected: 
+        void lowerSharedBound(); 
+};
+
+/** It looks for the k trail cores of lowest weight by iterative deepening: 
+  * @a search is run with the bounds @a firstBound, @a firstBound + @a step, 
+  * ... up to @a lastBound, and must add to @a lowest all the trail cores of 
+  * weight up to its bound. The deepening stops as soon as @a lowest is full, 
+  * since the k-th weight is then below the next bound. It prints nothing: 
+  * @a search may report its progress. 
+  * @return The last bound searched: there are no trail cores of weight up to 
+  *         this bound other than the ones in @a lowest (if not full). 
+  */ 
+template<class Search>
+unsigned int searchLowestWeightTrailCores(LowestWeightTrailCores& lowest, 
+                                          unsigned int firstBound, 
+                                          unsigned int lastBound, 
+                                          unsigned int step, 
+                                          Search search)
+{
+    unsigned int bound = min(firstBound, lastBound); 
+    while (true) {
+        search(bound, lowest); 
+        if (lowest.isFull() || (bound >= lastBound))
+            return bound; 
+        bound = min(bound + max(step, 1u), lastBound); 
+    }
+}
+
 /** Class used to read trail cores from a file. */ 
 class TrailFileIterator 
 {
@@ -118,6 +250,8 @@ class TrailFileIterator
         ifstream fin;
         bool end;
         TrailCore current;
+        /** The size of the file, in bytes. */
+        streamoff fileSize;
     public: 
         /** The constructor of the iterator.
           * @param  aFileName   The name of the file to read from.
@@ -129,6 +263,8 @@ class TrailFileIterator
         const TrailCore& operator*() const;
         /** It indicates whether the iterator has reached the end of the set of trails. */
         bool isEnd() const;
+        /** It returns the fraction of the file read so far. */
+        double getFractionRead();
 };
 
 /** It reads all the trail cores  in a file, checks their consistency and
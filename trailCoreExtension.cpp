@@ -1,6 +1,12 @@
 /** trailCore.cpp */
+#include <deque>
+#include <mutex>
+#include <thread>
 #include "trailCoreExtension.h"
 #include "forwardExtension.h"
+#include "progressReporter.h"
+#include "searchPhase.h"
+#include "trace.h"
 #include "trailCore.h"
 
 
@@ -58,47 +64,147 @@ ostream& operator<<(ostream& out, const LowWeightExclusion& lwe)
     return out;
 }
 
-void extendTrailCore(ostream& fout, const TrailCore& trailCore, 
-                     bool backwardExtension, unsigned int nrRounds, 
-                     long double maxTotalWeight, Weight& minWeightFound, 
-                     bool verbose)
+/** It returns the maximum total weight of the extended trail cores: 
+  * @a maxTotalWeight, or in top-K mode the K-th weight found if it is lower.
+  */
+static WeightBound getMaxTotalWeight(long double maxTotalWeight, 
+                                     const LowestWeightTrailCores* best)
+{
+    WeightBound bound(maxTotalWeight); 
+    if (best != NULL)
+        best->lowerBound(bound); 
+    return bound; 
+}
+
+/** It sets the known minimum weights of the trail cores of 1, 2 and 3 rounds. */
+static void setKnownBounds(LowWeightExclusion& knownBounds)
 {
-    LowWeightExclusion knownBounds; 
     knownBounds.excludeBelowWeight(0, 0);
     knownBounds.excludeBelowWeight(1, 2);
     knownBounds.excludeBelowWeight(2, 8);
     knownBounds.excludeBelowWeight(3, 24);
+}
+
+/** It extends @a trailCore with @a extension, saves it and, if it has less 
+  * than @a nrRounds rounds, extends it further (see recurseForwardExtendTrailCore).
+  * @return true if the recursion stops, ie without @a best, when a 
+  *         @a nrRounds-round trail core is reached. 
+  */
+static bool forwardExtendAndRecurse(ostream& fout, TrailCore& trailCore, 
+                                    const ForwardExtension& extension, 
+                                    unsigned int nrRounds, long double maxTotalWeight, 
+                                    Weight& minWeightFound, bool verbose, 
+                                    LowWeightExclusion& knownBounds, 
+                                    LowestWeightTrailCores* best, ExtensionCache* cache)
+{
+    trailCore.extendForward(extension);
+
+    // save even if not the desired length yet
+    trailCore.save(fout);
+    progress.addTrail(trailCore.weight);
+    if (trailCore.nrRounds == nrRounds) { 
+        if (trailCore.weight < minWeightFound) {
+            minWeightFound = trailCore.weight; 
+            if (verbose)
+                cout << "! " << dec << nrRounds << "-round trail of weight " << trailCore.weight << " found" << endl;
+        }
+        if (best == NULL) {
+            trailCore.retractForward(); 
+            return true; 
+        }
+        best->add(trailCore); 
+    } else {
+        recurseForwardExtendTrailCore(fout, trailCore, nrRounds, maxTotalWeight, minWeightFound, verbose, knownBounds, best, cache);
+    }
+    trailCore.retractForward(); 
+    return false; 
+}
 
+/** Same as forwardExtendAndRecurse, but backward. */
+static bool backwardExtendAndRecurse(ostream& fout, TrailCore& trailCore, 
+                                     const BackwardExtension& extension, 
+                                     unsigned int nrRounds, long double maxTotalWeight, 
+                                     Weight& minWeightFound, bool verbose, 
+                                     LowWeightExclusion& knownBounds, 
+                                     LowestWeightTrailCores* best, ExtensionCache* cache)
+{
+    trailCore.extendBackward(extension);
+    // save even if not the desired length yet
+    trailCore.save(fout);
+    progress.addTrail(trailCore.weight);
+    if (trailCore.nrRounds == nrRounds) { 
+        if (trailCore.weight < minWeightFound) {
+            minWeightFound = trailCore.weight; 
+            if (verbose)
+                cout << "! " << dec << nrRounds << "-round trail of weight " << trailCore.weight << " found" << endl;
+        }
+        if (best == NULL) {
+            trailCore.retractBackward(); 
+            return true; 
+        }
+        best->add(trailCore); 
+    } else {
+        recurseBackwardExtendTrailCore(fout, trailCore, nrRounds, maxTotalWeight, minWeightFound, verbose, knownBounds, best, cache);
+    }
+    trailCore.retractBackward(); 
+    return false; 
+}
+
+void extendTrailCore(ostream& fout, const TrailCore& trailCore, 
+                     bool backwardExtension, unsigned int nrRounds, 
+                     long double maxTotalWeight, Weight& minWeightFound, 
+                     bool verbose, LowestWeightTrailCores* best, 
+                     ExtensionCache* cache)
+{
+    LowWeightExclusion knownBounds; 
+    setKnownBounds(knownBounds); 
+
+    TrailCore trailToExtend(trailCore); 
     if (backwardExtension)
-        recurseBackwardExtendTrailCore(fout, trailCore, nrRounds, 
+        recurseBackwardExtendTrailCore(fout, trailToExtend, nrRounds, 
                                         maxTotalWeight, minWeightFound, 
-                                        verbose, knownBounds);
+                                        verbose, knownBounds, best, cache);
     else 
-        recurseForwardExtendTrailCore(fout, trailCore, nrRounds, 
+        recurseForwardExtendTrailCore(fout, trailToExtend, nrRounds, 
                                       maxTotalWeight, minWeightFound, 
-                                      verbose, knownBounds);
+                                      verbose, knownBounds, best, cache);
 }
 
 void extendTrailCores(ostream& fout, const string fileNameIn,
                       bool backwardExtension, unsigned int nrRounds, 
                       long double maxTotalWeight, 
-                      Weight& minWeightFound)
+                      Weight& minWeightFound, 
+                      LowestWeightTrailCores* best)
 {
    
     TrailFileIterator trailCores(fileNameIn);
+    unsigned int cpt = 0;
+    SearchPhase searchPhase("extendTrailCores", PerfCounters::input);
+    // Without best, the recursion stops at the first trail core of each 
+    // branch, which depends on the order of the extensions: the cache, which 
+    // translates the extensions of the canonical states, is only used in 
+    // top-K mode. 
+    ExtensionCache cache; 
+    ExtensionCache* usedCache = (best != NULL) ? &cache : NULL; 
     for (; ! trailCores.isEnd(); ++trailCores) {
+        TraceSpan trailSpan("trail core", TraceSpan::sampling);
+        progress.addNodes();
+        if (++cpt % 1024 == 0)
+            progress.setFractionDone(trailCores.getFractionRead());
         extendTrailCore(fout, *trailCores, backwardExtension, nrRounds,
-                          maxTotalWeight, minWeightFound, false);
+                          maxTotalWeight, minWeightFound, false, best, usedCache);
     }
 }
 
 void recurseForwardExtendTrailCore(ostream& fout, 
-                                   const TrailCore& trailCore, 
+                                   TrailCore& trailCore, 
                                    unsigned int nrRounds, 
                                    long double maxTotalWeight, 
                                    Weight& minWeightFound, 
                                    bool verbose, 
-                                   LowWeightExclusion& knownBounds)
+                                   LowWeightExclusion& knownBounds, 
+                                   LowestWeightTrailCores* best, 
+                                   ExtensionCache* cache)
 {
     if (verbose) {
         cout << "recurseExtendTrail Forward ( " ; 
@@ -110,10 +216,11 @@ void recurseForwardExtendTrailCore(ostream& fout,
     }
     
     Weight baseWeight = trailCore.weight - trailCore.wMinDir;
-    long double maxWeightExtension = maxTotalWeight - (long double) baseWeight
-                                     - (long double)knownBounds.getMinWeight(nrRounds - trailCore.nrRounds - 1);
+    Weight minWeightOtherRounds = knownBounds.getMinWeight(nrRounds - trailCore.nrRounds - 1); 
+    WeightBound maxWeightExtension = getMaxTotalWeight(maxTotalWeight, best) - baseWeight
+                                     - minWeightOtherRounds;
                
-    if (maxWeightExtension < (long double) knownBounds.getMinWeight(2)) {
+    if (maxWeightExtension < knownBounds.getMinWeight(2)) {
         if (verbose) {
             cout << " --leaving because maxWeightExtension (= " << maxWeightExtension; 
             cout << " ) < knownBounds.getMinWeight(2) (= " ; 
@@ -121,31 +228,43 @@ void recurseForwardExtendTrailCore(ostream& fout,
         }
         return; 
     }
+    if (cache != NULL) {
+        SearchStep extensionsStep("extensions", PerfCounters::forwardExtension);
+        vector<ForwardExtension> extensions; 
+        cache->getForwardExtensions(trailCore.differences.back(), maxWeightExtension, extensions); 
+        vector<ForwardExtension>::const_iterator extension; 
+        for (extension = extensions.begin(); extension != extensions.end(); ++extension) {
+            // in top-K mode, the bound may have been lowered since the query
+            if (!extension->isValidAndBelowWeight(getMaxTotalWeight(maxTotalWeight, best) 
+                                                  - baseWeight - minWeightOtherRounds))
+                continue; 
+            if (forwardExtendAndRecurse(fout, trailCore, *extension, nrRounds, maxTotalWeight, 
+                                        minWeightFound, verbose, knownBounds, best, cache))
+                return; 
+        }
+        return; 
+    }
+    SearchStep preparationStep("preparation", PerfCounters::forwardExtension);
     ForwardExtensionPreparation prep(trailCore.differences.back(), maxWeightExtension);  
+    preparationStep.stop();
+    SearchStep extensionsStep("extensions", PerfCounters::forwardExtension);
     ForwardExtensionIterator extensions(prep, trailCore.differences.back()); 
     for (; !extensions.isEnd(); ++extensions) {
-        ForwardExtension extension = *extensions;
-        TrailCore newTrailCore(trailCore, extension);
-
-        // save even if not the desired length yet
-        newTrailCore.save(fout);
-        if (newTrailCore.nrRounds == nrRounds) { 
-            if (newTrailCore.weight < minWeightFound) {
-                minWeightFound = newTrailCore.weight; 
-                if (verbose)
-                    cout << "! " << dec << nrRounds << "-round trail of weight " << newTrailCore.weight << " found" << endl;
-            }
+        if (forwardExtendAndRecurse(fout, trailCore, *extensions, nrRounds, maxTotalWeight, 
+                                    minWeightFound, verbose, knownBounds, best, cache))
             return; 
-        } else {
-            recurseForwardExtendTrailCore(fout, newTrailCore, nrRounds, maxTotalWeight, minWeightFound, verbose, knownBounds);
-        }
+        if (best != NULL)
+            extensions.lowerMaxWeightExtension(getMaxTotalWeight(maxTotalWeight, best) 
+                                               - baseWeight - minWeightOtherRounds); 
     } 
 }
 
-void recurseBackwardExtendTrailCore(ostream& fout, const TrailCore& trailCore, 
+void recurseBackwardExtendTrailCore(ostream& fout, TrailCore& trailCore, 
                                     unsigned int nrRounds, long double maxTotalWeight, 
                                     Weight& minWeightFound, bool verbose, 
-                                    LowWeightExclusion& knownBounds)
+                                    LowWeightExclusion& knownBounds, 
+                                    LowestWeightTrailCores* best, 
+                                    ExtensionCache* cache)
 {
     if (verbose) {
         cout << "recurseExtendTrail Backward ( " ; 
@@ -157,11 +276,11 @@ void recurseBackwardExtendTrailCore(ostream& fout, const TrailCore& trailCore,
     }
     
     Weight baseWeight = trailCore.weight - trailCore.wMinRev;
-
-    long double maxWeightExtension = maxTotalWeight - (long double) baseWeight
-                                     - (long double)knownBounds.getMinWeight(nrRounds - trailCore.nrRounds - 1);
+    Weight minWeightOtherRounds = knownBounds.getMinWeight(nrRounds - trailCore.nrRounds - 1); 
+    WeightBound maxWeightExtension = getMaxTotalWeight(maxTotalWeight, best) - baseWeight
+                                     - minWeightOtherRounds;
                 
-    if (maxWeightExtension < (long double) knownBounds.getMinWeight(2)) {
+    if (maxWeightExtension < knownBounds.getMinWeight(2)) {
         if (verbose) {
             cout << " --leaving because maxWeightExtension (= " << maxWeightExtension; 
             cout << " ) < knownBounds.getMinWeight(2) (= " ; 
@@ -169,22 +288,235 @@ void recurseBackwardExtendTrailCore(ostream& fout, const TrailCore& trailCore,
         }
         return; 
     }
+    if (cache != NULL) {
+        SearchStep extensionsStep("extensions", PerfCounters::backwardExtension);
+        vector<BackwardExtension> extensions; 
+        cache->getBackwardExtensions(trailCore.differences[0], maxWeightExtension, extensions); 
+        vector<BackwardExtension>::const_iterator extension; 
+        for (extension = extensions.begin(); extension != extensions.end(); ++extension) {
+            // in top-K mode, the bound may have been lowered since the query
+            if (!extension->isValidAndBelowWeight(getMaxTotalWeight(maxTotalWeight, best) 
+                                                  - baseWeight - minWeightOtherRounds))
+                continue; 
+            if (backwardExtendAndRecurse(fout, trailCore, *extension, nrRounds, maxTotalWeight, 
+                                         minWeightFound, verbose, knownBounds, best, cache))
+                return; 
+        }
+        return; 
+    }
+    SearchStep preparationStep("preparation", PerfCounters::backwardExtension);
     BackwardExtensionPreparation prep(trailCore.differences[0], maxWeightExtension);  
+    preparationStep.stop();
+    SearchStep extensionsStep("extensions", PerfCounters::backwardExtension);
     BackwardExtensionIterator extensions(prep, trailCore.differences[0]); 
     for (; !extensions.isEnd(); ++extensions) {
-        BackwardExtension extension = *extensions;
-        TrailCore newTrailCore(trailCore, extension);
-        // save even if not the desired length yet
-        newTrailCore.save(fout);
-        if (newTrailCore.nrRounds == nrRounds) { 
-            if (newTrailCore.weight < minWeightFound) {
-                minWeightFound = newTrailCore.weight; 
-                if (verbose)
-                    cout << "! " << dec << nrRounds << "-round trail of weight " << newTrailCore.weight << " found" << endl;
+        if (backwardExtendAndRecurse(fout, trailCore, *extensions, nrRounds, maxTotalWeight, 
+                                     minWeightFound, verbose, knownBounds, best, cache))
+            return; 
+        if (best != NULL)
+            extensions.lowerMaxWeightExtension(getMaxTotalWeight(maxTotalWeight, best) 
+                                               - baseWeight - minWeightOtherRounds); 
+    } 
+}
+
+/** The pool of threads of extendTrailCoresInParallel(). The units of work 
+  * are the trail cores of the input file and their one-round extensions: a 
+  * worker that reads a trail core needing at least two more rounds pushes its
+  * one-round extensions to its own deque and extends them from the back, 
+  * while the idle workers steal them from the front. 
+  */
+class ExtensionWorkers {
+    protected: 
+        typedef deque<TrailCore, AccountedAllocator<TrailCore, memoryTrailSets>> TaskDeque; 
+        bool backwardExtension; 
+        unsigned int nrRounds; 
+        long double maxTotalWeight; 
+        /** The input file, protected by inputLock. */ 
+        TrailFileIterator& input; 
+        UINT64 nrRead; 
+        mutex inputLock; 
+        vector<TaskDeque> tasks; 
+        vector<mutex> taskLocks; 
+        /** The number of workers that extend a trail core. */ 
+        atomic<unsigned int> nrActive; 
+        /** The number of trail cores in the deques. */ 
+        atomic<UINT64> nrQueued; 
+    public: 
+        ExtensionWorkers(TrailFileIterator& anInput, bool aBackwardExtension, 
+                         unsigned int aNrRounds, long double aMaxTotalWeight, 
+                         unsigned int nrWorkers)
+            : backwardExtension(aBackwardExtension), nrRounds(aNrRounds), 
+              maxTotalWeight(aMaxTotalWeight), input(anInput), nrRead(0), 
+              tasks(nrWorkers), taskLocks(nrWorkers), nrActive(0), nrQueued(0) {}
+        /** It runs the worker @a worker until all the trail cores are extended. */ 
+        void run(unsigned int worker, ostream& fout, Weight& minWeightFound, 
+                 LowestWeightTrailCores* best); 
+    protected: 
+        /** The three following methods get a trail core to extend and, if 
+          * one is found, count the worker as active. 
+          */ 
+        bool popTask(unsigned int worker, TrailCore& trail); 
+        bool stealTask(unsigned int worker, TrailCore& trail); 
+        bool readTask(TrailCore& trail); 
+        void pushTask(unsigned int worker, const TrailCore& trail); 
+        /** It saves the one-round extensions of @a trail, as the recursive 
+          * extension does, and pushes them to the deque of @a worker. 
+          */ 
+        void split(unsigned int worker, ostream& fout, TrailCore& trail, 
+                   LowWeightExclusion& knownBounds, LowestWeightTrailCores* best); 
+}; 
+
+bool ExtensionWorkers::popTask(unsigned int worker, TrailCore& trail)
+{
+    lock_guard<mutex> guard(taskLocks[worker]); 
+    if (tasks[worker].empty())
+        return false; 
+    nrActive++; 
+    trail = std::move(tasks[worker].back()); 
+    tasks[worker].pop_back(); 
+    nrQueued--; 
+    return true; 
+}
+
+bool ExtensionWorkers::stealTask(unsigned int worker, TrailCore& trail)
+{
+    for (unsigned int i = 1; i < tasks.size(); i++) {
+        unsigned int victim = (worker + i) % tasks.size(); 
+        lock_guard<mutex> guard(taskLocks[victim]); 
+        if (!tasks[victim].empty()) {
+            nrActive++; 
+            trail = std::move(tasks[victim].front()); 
+            tasks[victim].pop_front(); 
+            nrQueued--; 
+            return true; 
+        }
+    }
+    return false; 
+}
+
+bool ExtensionWorkers::readTask(TrailCore& trail)
+{
+    lock_guard<mutex> guard(inputLock); 
+    if (input.isEnd())
+        return false; 
+    nrActive++; 
+    trail = *input; 
+    ++input; 
+    progress.addNodes(); 
+    if (++nrRead % 1024 == 0)
+        progress.setFractionDone(input.getFractionRead()); 
+    return true; 
+}
+
+void ExtensionWorkers::pushTask(unsigned int worker, const TrailCore& trail)
+{
+    lock_guard<mutex> guard(taskLocks[worker]); 
+    nrQueued++; 
+    tasks[worker].push_back(trail); 
+}
+
+void ExtensionWorkers::split(unsigned int worker, ostream& fout, TrailCore& trail, 
+                             LowWeightExclusion& knownBounds, LowestWeightTrailCores* best)
+{
+    Weight baseWeight = trail.weight - (backwardExtension ? trail.wMinRev : trail.wMinDir); 
+    WeightBound maxWeightExtension = getMaxTotalWeight(maxTotalWeight, best) - baseWeight
+                                     - knownBounds.getMinWeight(nrRounds - trail.nrRounds - 1);
+    if (maxWeightExtension < knownBounds.getMinWeight(2))
+        return; 
+    if (backwardExtension) {
+        BackwardExtensionPreparation prep(trail.differences[0], maxWeightExtension);  
+        BackwardExtensionIterator extensions(prep, trail.differences[0]); 
+        for (; !extensions.isEnd(); ++extensions) {
+            trail.extendBackward(*extensions); 
+            trail.save(fout); 
+            progress.addTrail(trail.weight); 
+            pushTask(worker, trail); 
+            trail.retractBackward(); 
+        }
+    }
+    else {
+        ForwardExtensionPreparation prep(trail.differences.back(), maxWeightExtension);  
+        ForwardExtensionIterator extensions(prep, trail.differences.back()); 
+        for (; !extensions.isEnd(); ++extensions) {
+            trail.extendForward(*extensions); 
+            trail.save(fout); 
+            progress.addTrail(trail.weight); 
+            pushTask(worker, trail); 
+            trail.retractForward(); 
+        }
+    }
+}
+
+void ExtensionWorkers::run(unsigned int worker, ostream& fout, Weight& minWeightFound, 
+                           LowestWeightTrailCores* best)
+{
+    LowWeightExclusion knownBounds; 
+    setKnownBounds(knownBounds); 
+    // as in extendTrailCores, the cache is only used in top-K mode
+    ExtensionCache cache; 
+    ExtensionCache* usedCache = (best != NULL) ? &cache : NULL; 
+    TrailCore trail; 
+    while (true) {
+        bool fromInput = false; 
+        if (!popTask(worker, trail) && !stealTask(worker, trail)) {
+            fromInput = readTask(trail); 
+            if (!fromInput) {
+                // the input is read: the end is reached when no worker can 
+                // push trail cores anymore
+                if ((nrActive.load() == 0) && (nrQueued.load() == 0))
+                    return; 
+                this_thread::sleep_for(chrono::microseconds(100)); 
+                continue; 
             }
-            return;
-        } else {
-            recurseBackwardExtendTrailCore(fout, newTrailCore, nrRounds, maxTotalWeight, minWeightFound, verbose, knownBounds);
         }
-    } 
+        TraceSpan trailSpan("trail core", TraceSpan::sampling);
+        if (fromInput && (trail.nrRounds + 1 < nrRounds))
+            split(worker, fout, trail, knownBounds, best); 
+        else if (backwardExtension)
+            recurseBackwardExtendTrailCore(fout, trail, nrRounds, maxTotalWeight, 
+                                           minWeightFound, false, knownBounds, best, usedCache); 
+        else 
+            recurseForwardExtendTrailCore(fout, trail, nrRounds, maxTotalWeight, 
+                                          minWeightFound, false, knownBounds, best, usedCache); 
+        nrActive--; 
+    }
+}
+
+void extendTrailCoresInParallel(const string& fileNameOut, const string fileNameIn,
+                                bool backwardExtension, unsigned int nrRounds, 
+                                long double maxTotalWeight, Weight& minWeightFound, 
+                                unsigned int nrThreads, LowestWeightTrailCores* best)
+{
+    if (nrThreads == 0)
+        nrThreads = max(1u, thread::hardware_concurrency()); 
+    TrailFileIterator trailCores(fileNameIn);
+    // the calling thread only waits for the workers
+    SearchPhase searchPhase("extendTrailCoresInParallel", PerfCounters::other);
+    ExtensionWorkers workers(trailCores, backwardExtension, nrRounds, 
+                             maxTotalWeight, nrThreads); 
+
+    // the workers share the K-th weight of their sets through sharedBound 
+    atomic<long long> sharedBound(WeightBound(maxTotalWeight).scaled); 
+    vector<LowestWeightTrailCores> bests; 
+    if (best != NULL) {
+        best->shareBound(&sharedBound); 
+        bests.assign(nrThreads, *best); 
+    }
+    vector<Weight> minWeights(nrThreads, minWeightFound); 
+    vector<thread> threads; 
+    for (unsigned int i = 0; i < nrThreads; i++) {
+        threads.push_back(thread([&, i]() {
+            ofstream fout((fileNameOut + "-" + to_string(i)).c_str()); 
+            workers.run(i, fout, minWeights[i], (best != NULL) ? &bests[i] : NULL); 
+        })); 
+    }
+    for (unsigned int i = 0; i < nrThreads; i++) {
+        threads[i].join(); 
+        if (minWeights[i] < minWeightFound)
+            minWeightFound = minWeights[i]; 
+        if (best != NULL)
+            best->add(bests[i]); 
+    }
+    if (best != NULL)
+        best->shareBound(NULL); 
 }
@@ -5,6 +5,7 @@
 #include <map>
 #include "trailCore.h"
 #include "backwardExtension.h"
+#include "extensionCache.h"
 #include "forwardExtension.h"
 
 /*
@@ -53,7 +54,11 @@ class LowWeightExclusion {
   * @param maxTotalWeight    The maximum total weight for the extended trail core
   * @param minWeightFound    Variable to set the minimum weight of the @nrRounds-round trail cores reached.  
   * @param verbose           If true, the function will display indications about the extension.
-  *                     
+  * @param best              If not NULL, the top-K mode: the @nrRounds-round trail 
+  *                          cores are added to @a best and, once it is full, the 
+  *                          maximum total weight is lowered to the K-th weight found. 
+  * @param cache             If not NULL, the extensions of each round are taken
+  *                          from @a cache (see extensionCache.h). 
   *
   */ 
 void extendTrailCore(ostream& fout, 
@@ -62,7 +67,9 @@ void extendTrailCore(ostream& fout,
                      unsigned int nrRounds, 
                      long double maxTotalWeight, 
                      Weight& minWeightFound, 
-                     bool verbose);
+                     bool verbose, 
+                     LowestWeightTrailCores* best = NULL, 
+                     ExtensionCache* cache = NULL);
         
 /** This function is like extendTrailCore, except that it 
   * processes all the trails from @a fileNameIn.
@@ -73,6 +80,10 @@ void extendTrailCore(ostream& fout,
   * @param nrRounds          The target number of rounds. 
   * @param maxTotalWeight    The maximum total weight for the extended trail core
   * @param minWeightFound    Variable to set the minimum weight of the @nrRounds-round trail cores reached. 
+  * @param best              If not NULL, the top-K mode (see extendTrailCore()), 
+  *                          shared by all the trail cores of the file. 
+  * The extensions are taken from an ExtensionCache shared by all the trail 
+  * cores of the file, and by the rounds of their extensions. 
   * 
   */ 
 void extendTrailCores(ostream& fout, 
@@ -80,22 +91,52 @@ void extendTrailCores(ostream& fout,
                       bool backwardExtension,
                       unsigned int nrRounds, 
                       long double maxTotalWeight, 
-                      Weight& minWeightFound);
+                      Weight& minWeightFound, 
+                      LowestWeightTrailCores* best = NULL);
 
+/** This function is like extendTrailCores, except that the trail cores of 
+  * @a fileNameIn and their one-round extensions are extended by a pool of 
+  * @a nrThreads threads (0 for one per hardware thread), with work stealing. 
+  * The thread i writes its trail cores to the file @a fileNameOut-i. 
+  * In top-K mode, the threads keep their own sets of K trail cores, which 
+  * share the lowest K-th weight as the bound of all the threads, and the 
+  * sets are added to @a best at the end. Each thread has its own 
+  * ExtensionCache. 
+  */ 
+void extendTrailCoresInParallel(const string& fileNameOut, 
+                                const string fileNameIn,
+                                bool backwardExtension,
+                                unsigned int nrRounds, 
+                                long double maxTotalWeight, 
+                                Weight& minWeightFound, 
+                                unsigned int nrThreads = 0, 
+                                LowestWeightTrailCores* best = NULL);
+
+/** The two following functions extend @a trailCore in place, one round at a
+  * time, and retract it before returning, so that @a trailCore is unchanged 
+  * when they return. Without @a best, they stop at the first @a nrRounds-round
+  * trail core of each branch; with @a best, they enumerate all of them and 
+  * tighten the bound of the extensions still to enumerate whenever the K-th 
+  * weight decreases. 
+  */ 
 void recurseForwardExtendTrailCore(ostream& fout, 
-                                   const TrailCore& trailCore, 
+                                   TrailCore& trailCore, 
                                    unsigned int nrRounds, 
                                    long double maxTotalWeight, 
                                    Weight& minWeightFound, 
                                    bool verbose, 
-                                   LowWeightExclusion& knownBounds);
+                                   LowWeightExclusion& knownBounds, 
+                                   LowestWeightTrailCores* best = NULL, 
+                                   ExtensionCache* cache = NULL);
     
 void recurseBackwardExtendTrailCore(ostream& fout, 
-                                    const TrailCore& trailCore, 
+                                    TrailCore& trailCore, 
                                     unsigned int nrRounds, 
                                     long double maxTotalWeight, 
                                     Weight& minWeightFound, 
                                     bool verbose, 
-                                    LowWeightExclusion& knownBounds);
+                                    LowWeightExclusion& knownBounds, 
+                                    LowestWeightTrailCores* best = NULL, 
+                                    ExtensionCache* cache = NULL);
 
 #endif 
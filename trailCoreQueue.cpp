@@ -0,0 +1,54 @@
+/* trailCoreQueue.cpp */
+#include "trailCoreQueue.h"
+
+size_t TrailCoreQueue::defaultBatchSize = 256;
+size_t TrailCoreQueue::defaultMaxNrBatches = 64;
+
+TrailCoreQueue::TrailCoreQueue(size_t aBatchSize, size_t aMaxNrBatches)
+: batchSize(aBatchSize), maxNrBatches(aMaxNrBatches), closed(false), nrProducerWaits(0)
+{
+    current.reserve(batchSize);
+}
+
+void TrailCoreQueue::push(const TrailCore& trail)
+{
+    current.push_back(trail);
+    if (current.size() >= batchSize)
+        pushCurrentBatch();
+}
+
+void TrailCoreQueue::close()
+{
+    if (!current.empty())
+        pushCurrentBatch();
+    lock_guard<mutex> guard(lock);
+    closed = true;
+    notEmpty.notify_all();
+}
+
+bool TrailCoreQueue::pop(Batch& batch)
+{
+    unique_lock<mutex> guard(lock);
+    notEmpty.wait(guard, [this]() { return !batches.empty() || closed; });
+    if (batches.empty())
+        return false;
+    batch = std::move(batches.front());
+    batches.pop_front();
+    notFull.notify_one();
+    return true;
+}
+
+void TrailCoreQueue::pushCurrentBatch()
+{
+    {
+        unique_lock<mutex> guard(lock);
+        if (batches.size() >= maxNrBatches) {
+            nrProducerWaits++;
+            notFull.wait(guard, [this]() { return batches.size() < maxNrBatches; });
+        }
+        batches.push_back(std::move(current));
+        notEmpty.notify_one();
+    }
+    current = Batch();
+    current.reserve(batchSize);
+}
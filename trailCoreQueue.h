@@ -0,0 +1,65 @@
+/* trailCoreQueue.h */
+#ifndef TRAIL_CORE_QUEUE_H
+#define TRAIL_CORE_QUEUE_H
+
+/*
+The class of this file connects a stage that generates trail cores to the
+threads that extend them, without an intermediate file. The producer adds the
+trail cores one by one; they are passed to the consumers in batches, so that
+the lock is only taken once per batch. The number of batches waiting in the
+queue is bounded: when the consumers are slower than the producer, the
+producer waits, and the memory used stays bounded.
+*/
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include "memoryAccounting.h"
+#include "trailCore.h"
+
+class TrailCoreQueue {
+    public:
+        typedef vector<TrailCore, AccountedAllocator<TrailCore, memoryTrailSets> > Batch; 
+        /** The number of trail cores per batch of the queues built with the
+          * default constructor. 
+          */ 
+        static size_t defaultBatchSize; 
+        /** The maximum number of batches waiting in the queues built with 
+          * the default constructor. 
+          */ 
+        static size_t defaultMaxNrBatches; 
+    protected: 
+        size_t batchSize; 
+        size_t maxNrBatches; 
+        /** The batch being filled by the producer. */ 
+        Batch current; 
+        /** The batches waiting for a consumer, protected by lock. */ 
+        deque<Batch> batches; 
+        /** True when the producer has added its last trail core. */ 
+        bool closed; 
+        mutex lock; 
+        condition_variable notEmpty; 
+        condition_variable notFull; 
+        /** The number of times the producer waited for a consumer. */ 
+        UINT64 nrProducerWaits; 
+    public: 
+        TrailCoreQueue(size_t aBatchSize = defaultBatchSize, 
+                       size_t aMaxNrBatches = defaultMaxNrBatches); 
+        /** It adds @a trail to the current batch, and passes the batch to 
+          * the consumers when it is full. Only called by the producer. 
+          */ 
+        void push(const TrailCore& trail); 
+        /** It passes the last batch to the consumers and wakes them up. 
+          * Only called by the producer, after its last push(). 
+          */ 
+        void close(); 
+        /** It waits for a batch and moves it to @a batch. 
+          * @return false if the queue is closed and empty. 
+          */ 
+        bool pop(Batch& batch); 
+        UINT64 getNrProducerWaits() const { return nrProducerWaits; }
+    protected: 
+        void pushCurrentBatch(); 
+}; 
+
+#endif
@@ -0,0 +1,97 @@
+/** traversal.cpp */
+#include <fstream>
+#include "traversal.h"
+
+template<class T>
+static void addPerDepth(vector<T>& counters, const vector<T>& others)
+{
+    if (counters.size() < others.size())
+        counters.resize(others.size(), 0); 
+    for (unsigned int depth = 0; depth < others.size(); depth++)
+        counters[depth] += others[depth]; 
+}
+
+template<class T>
+static void savePerDepthJSON(ostream& fout, const string& name, const vector<T>& counters)
+{
+    fout << "\"" << name << "\": ["; 
+    for (unsigned int depth = 0; depth < counters.size(); depth++) {
+        if (depth > 0)
+            fout << ", "; 
+        fout << counters[depth]; 
+    }
+    fout << "]"; 
+}
+
+void TraversalStatistics::operator += (const TraversalStatistics& other)
+{
+    addPerDepth(nodes, other.nodes); 
+    addPerDepth(pushes, other.pushes); 
+    addPerDepth(pops, other.pops); 
+    addPerDepth(endOfSets, other.endOfSets); 
+    addPerDepth(costPruned, other.costPruned); 
+    addPerDepth(nonCanonical, other.nonCanonical); 
+    addPerDepth(seconds, other.seconds); 
+}
+
+void TraversalStatistics::saveJSON(ostream& fout) const
+{
+    fout << dec << "{"; 
+    savePerDepthJSON(fout, "nodes", nodes); 
+    fout << ", "; 
+    savePerDepthJSON(fout, "pushes", pushes); 
+    fout << ", "; 
+    savePerDepthJSON(fout, "pops", pops); 
+    fout << ", "; 
+    savePerDepthJSON(fout, "endOfSets", endOfSets); 
+    fout << ", "; 
+    savePerDepthJSON(fout, "costPruned", costPruned); 
+    fout << ", "; 
+    savePerDepthJSON(fout, "nonCanonical", nonCanonical); 
+    fout << ", "; 
+    savePerDepthJSON(fout, "seconds", seconds); 
+    fout << "}"; 
+}
+
+void saveTraversalStatistics(const string& fileName, 
+                             const vector<pair<string, TraversalStatistics>>& statistics)
+{
+    ofstream fout(fileName.c_str()); 
+    fout << "{" << endl; 
+    for (unsigned int i = 0; i < statistics.size(); i++) {
+        fout << "  \"" << statistics[i].first << "\": "; 
+        statistics[i].second.saveJSON(fout); 
+        fout << ((i + 1 < statistics.size()) ? "," : "") << endl; 
+    }
+    fout << "}" << endl; 
+}
+
+void TreeSizeEstimate::setMeanAndStdError(const vector<double>& samples, 
+                                          double& mean, double& stdError)
+{
+    mean = 0; 
+    stdError = 0; 
+    if (samples.empty())
+        return; 
+    for (unsigned int i = 0; i < samples.size(); i++)
+        mean += samples[i]; 
+    mean /= samples.size(); 
+    if (samples.size() < 2)
+        return; 
+    double variance = 0; 
+    for (unsigned int i = 0; i < samples.size(); i++)
+        variance += (samples[i] - mean) * (samples[i] - mean); 
+    variance /= samples.size() - 1; 
+    stdError = sqrt(variance / samples.size()); 
+}
+
+void TreeSizeEstimate::saveJSON(ostream& fout) const
+{
+    fout << dec << "{\"probes\": " << nrProbes; 
+    fout << ", \"nodes\": " << nodes << ", \"nodesStdError\": " << nodesStdError; 
+    fout << ", \"leaves\": " << leaves << ", \"leavesStdError\": " << leavesStdError; 
+    fout << ", \"nestedNodes\": " << nestedNodes; 
+    fout << ", \"nestedNodesStdError\": " << nestedNodesStdError; 
+    fout << ", \"secondsPerNode\": " << secondsPerNode; 
+    fout << ", \"projectedSeconds\": " << getProjectedSeconds() << "}"; 
+}
@@ -10,16 +10,120 @@ Keccak" by Silvia Mella, Joan Daemen and Gilles Van Assche.
 
 #ifndef TRAVERSAL_H
 #define TRAVERSAL_H
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <random>
 #include <stack>
+#include <string>
+#include <utility>
 #include <vector>
+#include "memoryAccounting.h"
 #include "types.h"
 
+#ifdef TRAVERSAL_STATISTICS
+#include <chrono>
+#define TRAVERSAL_STATISTICS_ONLY(...) __VA_ARGS__
+#else
+#define TRAVERSAL_STATISTICS_ONLY(...)
+#endif
+
 using namespace std;
 
 /** This exception is launched when a set of units reaches the end.
   */
 class EndOfSet {};
+
+/** This class stores statistics about the traversal of a tree, per depth 
+  * (ie per number of units of the unit-list). They are only recorded by 
+  * a GenericTreeIterator if the code is compiled with TRAVERSAL_STATISTICS 
+  * defined, otherwise the iterator does not contain any statistics. 
+  */
+class TraversalStatistics {
+    public:
+        /** Number of nodes visited (ie affordable and canonical) per depth. */
+        vector<UINT64> nodes; 
+        /** Number of units pushed per depth reached. */
+        vector<UINT64> pushes; 
+        /** Number of units popped per depth left. */
+        vector<UINT64> pops; 
+        /** Number of EndOfSet raised when looking for a unit of a given depth. */
+        vector<UINT64> endOfSets; 
+        /** Number of children rejected because their cost is too high. */
+        vector<UINT64> costPruned; 
+        /** Number of children rejected because they are not canonical. */
+        vector<UINT64> nonCanonical; 
+        /** Time (in seconds) spent to reach the nodes of a given depth. */
+        vector<double> seconds; 
+    public:
+        /** It increments @a counter at depth @a depth. */
+        static void count(vector<UINT64>& counter, unsigned int depth)
+        {
+            if (counter.size() <= depth)
+                counter.resize(depth + 1, 0); 
+            counter[depth]++; 
+        }
+        void addTime(unsigned int depth, double time)
+        {
+            if (seconds.size() <= depth)
+                seconds.resize(depth + 1, 0); 
+            seconds[depth] += time; 
+        }
+        /** It adds the statistics of another traversal to these ones. */
+        void operator += (const TraversalStatistics& other); 
+        /** It outputs the statistics as a JSON object. */ 
+        void saveJSON(ostream& fout) const; 
+};
+
+/** This class stores an estimation of the size of a tree obtained with
+  * GenericTreeIterator::estimateSize(). Each estimation is the mean over 
+  * the probes and comes with its standard error, so that 
+  * [estimation - 1.96 * stdError, estimation + 1.96 * stdError] is a 95% 
+  * confidence interval. 
+  */
+class TreeSizeEstimate {
+    public:
+        /** The number of random probes. */ 
+        unsigned int nrProbes; 
+        /** The estimated number of nodes (the root excluded). */
+        double nodes; 
+        double nodesStdError; 
+        /** The estimated number of leaves. */ 
+        double leaves; 
+        double leavesStdError; 
+        /** The estimated number of nodes of the trees traversed for each 
+          * node of this tree (eg the N_TrailCore_Iterator run for each 
+          * bare state), if any. 
+          */
+        double nestedNodes; 
+        double nestedNodesStdError; 
+        /** The calibrated time spent per node (nested nodes included), 
+          * or 0 if unknown. 
+          */
+        double secondsPerNode; 
+    public:
+        TreeSizeEstimate(): nrProbes(0), nodes(0), nodesStdError(0), 
+            leaves(0), leavesStdError(0), nestedNodes(0), 
+            nestedNodesStdError(0), secondsPerNode(0) {}
+        /** It returns the projected time of the traversal, in seconds. */
+        double getProjectedSeconds() const
+        {
+            return (nodes + nestedNodes) * secondsPerNode; 
+        }
+        /** It sets the estimation and its standard error from the samples 
+          * of the probes. 
+          */ 
+        static void setMeanAndStdError(const vector<double>& samples, 
+                                       double& mean, double& stdError); 
+        /** It outputs the estimation as a JSON object. */ 
+        void saveJSON(ostream& fout) const; 
+};
+
+/** It saves in the file @a fileName a JSON object whose members are 
+  * the named statistics given in @a statistics. 
+  */
+void saveTraversalStatistics(const string& fileName, 
+                             const vector<pair<string, TraversalStatistics>>& statistics); 
 /** This class represents an iterator to traverse a tree.
   * The type of tree is defined by the unitList.
   */
@@ -41,6 +145,11 @@ class GenericTreeIterator {
 	std::vector<unsigned int> cost;
 	/** The maximum cost allowed when traversing the tree. */
 	unsigned int maxCost;
+	/** The minimum cost of the nodes output. The nodes of lower cost are 
+	  * still traversed, since the cost only grows along the branches, but 
+	  * the iterator does not stop on them. 
+	  */
+	unsigned int minCost;
 	/** Attribute that indicates whether the iterator has reached the end. */
 	bool end;
 	/** Attribute that indicates whether the iterator has been initialized. */
@@ -49,6 +158,16 @@ class GenericTreeIterator {
 	bool empty;
 	/** Number of the current iteration. */
 	UINT64 index;
+	/** Number of nodes of depth 1 visited so far, ie the index (starting 
+	  * from 1) of the current first-level unit. 
+	  */
+	UINT64 nrFirstLevelNodes;
+#ifdef TRAVERSAL_STATISTICS
+	/** The statistics of the traversal. */
+	TraversalStatistics statistics;
+#endif
+	/** The memory used by unitList and cost. */
+	MemoryCounter memory;
 
 public:
 	 /** The constructor.
@@ -57,19 +176,22 @@ public:
        * @param  aCostFunction The cost function. 
        * @param  aMaxCost The maximum cost.
        * @param  setFirstNode True if we are not interested in the empty unit-list. 
+       * @param  aMinCost The minimum cost of the nodes output. 
        */
 	GenericTreeIterator(const UnitSet& aUnitSet, 
                         CachedRepresentation aCache,
                         const CostFunction& aCostFunction,
                         unsigned int aMaxCost, 
-                        bool setFirstNode)
+                        bool setFirstNode,
+                        unsigned int aMinCost = 0)
 		: unitSet(aUnitSet), cache(aCache), costFunction(aCostFunction),
-          maxCost(aMaxCost)
+          maxCost(aMaxCost), minCost(aMinCost), memory(memoryIterators)
 	{
 		empty = true;
 		end = false;
 		initialized = false;
 		index = 0;
+		nrFirstLevelNodes = 0;
         
         // modication of the original code
         if (setFirstNode)
@@ -96,16 +218,87 @@ public:
 	  */
 	void operator++()
 	{
+		TRAVERSAL_STATISTICS_ONLY(chrono::steady_clock::time_point start = chrono::steady_clock::now();)
 		if (!initialized) {
 			initialize();
 		}
 		else {
 			if (!end) {
 				++index;
-				if (!next())
+				if (!nextNotBelowMinCost())
 					end = true;
 			}
 		}
+		TRAVERSAL_STATISTICS_ONLY(statistics.addTime(unitList.size(), 
+			chrono::duration<double>(chrono::steady_clock::now() - start).count());)
+	}
+
+	/** This method estimates the size of the tree with Knuth's random 
+	  * probes: each probe goes from the root to a leaf by choosing at 
+	  * each node a child uniformly at random, and a node of depth d is 
+	  * weighted by the product of the numbers of children of its 
+	  * ancestors. With @a width > 1, a probe explores min(@a width, number 
+	  * of children) children of each node (partial backtracking), which 
+	  * reduces the variance at the price of longer probes. 
+	  * The iterator must be at the root, ie constructed with setFirstNode
+	  * false and not incremented; it is still at the root afterwards. 
+	  * The probes visit the nodes in a random order, so the tree must not 
+	  * depend on the nodes visited before: a cache that prunes the nodes 
+	  * already seen must have this pruning disabled (eg uniquePatterns of 
+	  * ActiveStatesCAndDCache), and the estimation is then an upper bound
+	  * on the size of the pruned tree. 
+	  * @param  nrProbes  The number of probes.
+	  * @param  width     The number of children explored per node.
+	  * @param  generator The random generator.
+	  * @param  nestedEstimator  A function that returns, for the output 
+	  *                   representation of a node, an estimation of the size
+	  *                   of a tree traversed for this node (or 0). 
+	  * @return The estimation, with secondsPerNode = 0. 
+	  */
+	template<class NestedEstimator>
+	TreeSizeEstimate estimateSize(unsigned int nrProbes, unsigned int width, 
+	                              mt19937_64& generator, 
+	                              NestedEstimator nestedEstimator)
+	{
+		assert(!initialized && unitList.empty());
+		assert(width > 0);
+		TRAVERSAL_STATISTICS_ONLY(TraversalStatistics savedStatistics = statistics;)
+		vector<double> nodeSamples, leafSamples, nestedSamples;
+		for (unsigned int i = 0; i < nrProbes; i++) {
+			double nodes = 0, leaves = 0, nested = 0;
+			probe(1.0, width, generator, nestedEstimator, nodes, leaves, nested);
+			nodeSamples.push_back(nodes);
+			leafSamples.push_back(leaves);
+			nestedSamples.push_back(nested);
+		}
+		TreeSizeEstimate estimate;
+		estimate.nrProbes = nrProbes;
+		TreeSizeEstimate::setMeanAndStdError(nodeSamples, estimate.nodes, estimate.nodesStdError);
+		TreeSizeEstimate::setMeanAndStdError(leafSamples, estimate.leaves, estimate.leavesStdError);
+		TreeSizeEstimate::setMeanAndStdError(nestedSamples, estimate.nestedNodes, estimate.nestedNodesStdError);
+		TRAVERSAL_STATISTICS_ONLY(statistics = savedStatistics;)
+		return estimate;
+	}
+
+	/** Same as above, without nested trees. */
+	TreeSizeEstimate estimateSize(unsigned int nrProbes, unsigned int width, 
+	                              mt19937_64& generator)
+	{
+		return estimateSize(nrProbes, width, generator, 
+		                    [](const OutputRepresentation&) { return 0.0; });
+	}
+
+	/** This method returns the number of nodes of depth 1, which lets 
+	  * one turn nrFirstLevelNodes into a rough fraction of the tree done.
+	  * The iterator must be at the root, as for estimateSize(). 
+	  */
+	unsigned int countFirstLevelUnits()
+	{
+		assert(!initialized && unitList.empty());
+		TRAVERSAL_STATISTICS_ONLY(TraversalStatistics savedStatistics = statistics;)
+		unsigned int count = getChildrenUnits().size();
+		TRAVERSAL_STATISTICS_ONLY(statistics = savedStatistics;)
+		return count;
 	}
 
 	/** The '*' operator gives a constant reference to the current node.
@@ -123,8 +316,9 @@ private:
 	  */
 	void initialize()
 	{
+		TRAVERSAL_STATISTICS_ONLY(chrono::steady_clock::time_point start = chrono::steady_clock::now();)
 		index = 0;
-		if (first()) {
+		if (first() && (cost.back() >= minCost || nextNotBelowMinCost())) {
 			end = false;
 			empty = false;
 		}
@@ -133,6 +327,8 @@ private:
 			empty = true;
 		}
 		initialized = true;
+		TRAVERSAL_STATISTICS_ONLY(statistics.addTime(unitList.size(), 
+			chrono::duration<double>(chrono::steady_clock::now() - start).count());)
 	}
 
 	/** This method returns the first node of the tree.
@@ -158,6 +354,19 @@ private:
 		} while (true);
 	}
 
+	/** This method returns the next node of the tree whose cost is at 
+	  * least minCost.
+	  * @return true if such a node exists, false otherwise.
+	  */
+	bool nextNotBelowMinCost()
+	{
+		do {
+			if (!next())
+				return false;
+		} while (cost.back() < minCost);
+		return true;
+	}
+
 	/** This method moves to the first child of the current node.
 	  * A child is obtained adding a new unit to the current node.
 	  * @return true if a child is found, false otherwise.
@@ -169,7 +378,7 @@ private:
 		try {
 			Unit newUnit = unitSet.getFirstChildUnit(unitList,cache);	
 			push(newUnit);
-			if (cost.back() <= maxCost && isCanonical())
+			if (isAffordableAndCanonical())
 				return true;
 			else {
 				if (iterateHighestUnit())
@@ -181,6 +390,7 @@ private:
 			}	
 		}
 		catch (EndOfSet) {
+			TRAVERSAL_STATISTICS_ONLY(TraversalStatistics::count(statistics.endOfSets, unitList.size() + 1);)
 			return false;
 		}
 	}
@@ -224,12 +434,13 @@ private:
 				unitSet.iterateUnit(unitList, lastUnit,cache);
 			}
 			catch (EndOfSet) {
+				TRAVERSAL_STATISTICS_ONLY(TraversalStatistics::count(statistics.endOfSets, unitList.size() + 1);)
                 pushDummy(lastUnit); // something to pop is needed by the function toParent()
 				return false;
 			}
 			
 			push(lastUnit);
-			if (cost.back() <= maxCost && isCanonical())
+			if (isAffordableAndCanonical())
 				return true;
 			pop();
 		} while (true);
@@ -244,6 +455,8 @@ private:
 		unitList.push_back(newUnit);
 		cache.push(newUnit);
 		cost.push_back(costFunction.getCost(unitList, cache));
+		TRAVERSAL_STATISTICS_ONLY(TraversalStatistics::count(statistics.pushes, unitList.size());)
+		memory.set(unitList.capacity() * sizeof(Unit) + cost.capacity() * sizeof(unsigned int));
 	}
 
 	/** This method pushes a dummy unit.
@@ -263,12 +476,65 @@ private:
 	{
 		if (unitList.empty())
 			return false;
+		TRAVERSAL_STATISTICS_ONLY(TraversalStatistics::count(statistics.pops, unitList.size());)
 		cache.pop(unitList.back());
 		unitList.pop_back();
 		cost.pop_back();
 		return true;
 	}
 
+	/** This method returns the units that can be pushed to obtain the 
+	  * children of the current node.
+	  */
+	vector<Unit> getChildrenUnits()
+	{
+		vector<Unit> children;
+		try {
+			Unit unit = unitSet.getFirstChildUnit(unitList, cache);
+			do {
+				push(unit);
+				if (cost.back() <= maxCost && isCanonical())
+					children.push_back(unit);
+				pop();
+				unitSet.iterateUnit(unitList, unit, cache);
+			} while (true);
+		}
+		catch (EndOfSet) {
+		}
+		return children;
+	}
+
+	/** This method runs a probe of estimateSize() from the current node, 
+	  * whose weight is @a weight, and adds the weighted counts of the nodes
+	  * reached to @a nodes, @a leaves and @a nested.
+	  */
+	template<class NestedEstimator>
+	void probe(double weight, unsigned int width, mt19937_64& generator, 
+	           NestedEstimator& nestedEstimator, 
+	           double& nodes, double& leaves, double& nested)
+	{
+		vector<Unit> children = getChildrenUnits();
+		if (children.empty()) {
+			if (!unitList.empty())
+				leaves += weight;
+			return;
+		}
+		unsigned int nrExplored = min<size_t>(width, children.size());
+		// the first nrExplored units become a uniform random subset
+		for (unsigned int i = 0; i < nrExplored; i++) {
+			uniform_int_distribution<size_t> distribution(i, children.size() - 1);
+			swap(children[i], children[distribution(generator)]);
+		}
+		double childWeight = weight * children.size() / nrExplored;
+		for (unsigned int i = 0; i < nrExplored; i++) {
+			push(children[i]);
+			nodes += childWeight;
+			nested += childWeight * nestedEstimator(**this);
+			probe(childWeight, width, generator, nestedEstimator, nodes, leaves, nested);
+			pop();
+		}
+	}
+
 	/** This method checks if the current node is canonical
 	  * with respect to an order relation specified by the unitSet.
 	  * @return true if the current node is canonical, false otherwise.
@@ -277,6 +543,26 @@ private:
 	{
 		return unitSet.isCanonical(unitList, cache);
 	}
+
+	/** This method checks if the cost of the current node is not too high
+	  * and if the current node is canonical. 
+	  * @return true if the current node is a node of the tree, false otherwise.
+	  */
+	bool isAffordableAndCanonical()
+	{
+		if (cost.back() > maxCost) {
+			TRAVERSAL_STATISTICS_ONLY(TraversalStatistics::count(statistics.costPruned, unitList.size());)
+			return false;
+		}
+		if (!isCanonical()) {
+			TRAVERSAL_STATISTICS_ONLY(TraversalStatistics::count(statistics.nonCanonical, unitList.size());)
+			return false;
+		}
+		TRAVERSAL_STATISTICS_ONLY(TraversalStatistics::count(statistics.nodes, unitList.size());)
+		if (unitList.size() == 1)
+			nrFirstLevelNodes++;
+		return true;
+	}
 };
 
 #endif
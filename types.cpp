@@ -11,3 +11,9 @@ ostream & operator << (ostream& fout, const Weight& aWeight)
     }
     return fout; 
 }
+
+ostream & operator << (ostream& fout, const WeightBound& aBound)
+{
+    fout << (long double)aBound; 
+    return fout; 
+}
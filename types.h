@@ -13,6 +13,7 @@ We thank Silvia Mella and Gilles Van Assche for their intelligible code.
 #include <iostream>
 #include <assert.h>
 #include <sstream>
+#include <cmath>
 
 using namespace std;
 typedef unsigned char       UINT8;
@@ -26,6 +27,47 @@ typedef unsigned long long  UINT64;
 #define DIAGONAL 9
 #define LOG      2.369070246428542692 /* - log <sub> 3 <\sub> (2 / 27) */
 
+/** Weights are compared exactly through the fixed-point key 
+  * integer * 2^WEIGHT_SCALE_BITS + logPart * WEIGHT_LOG_SCALED 
+  * (see Weight::fixedPoint()). The key is exact (ie it orders the weights as 
+  * the real numbers integer + LOG * logPart) as long as integer does not exceed
+  * WEIGHT_MAX_INTEGER and logPart does not exceed WEIGHT_MAX_LOG_PART. 
+  */
+#define WEIGHT_SCALE_BITS   40
+#define WEIGHT_MAX_INTEGER  (1 << 20)
+#define WEIGHT_MAX_LOG_PART (1 << 16)
+
+constexpr long long   WEIGHT_SCALE      = 1LL << WEIGHT_SCALE_BITS; 
+constexpr long double WEIGHT_LOG_EXACT  = 2.369070246428542692L; 
+constexpr long long   WEIGHT_LOG_SCALED = (long long)(WEIGHT_LOG_EXACT * WEIGHT_SCALE + 0.5L); 
+
+/** It checks that the fixed-point key orders all the weights in range as 
+  * their real value. Two weights whose logParts differ by d have real values 
+  * differing by |k + LOG * d| for an integer k, which is at least the distance
+  * from LOG * d to the nearest integer, whereas their keys are off by at most 
+  * d times the rounding error of WEIGHT_LOG_SCALED. 
+  */
+constexpr bool isFixedPointWeightOrderingExact()
+{
+    const long double error = (WEIGHT_LOG_SCALED > WEIGHT_LOG_EXACT * WEIGHT_SCALE ? 
+                               WEIGHT_LOG_SCALED - WEIGHT_LOG_EXACT * WEIGHT_SCALE :
+                               WEIGHT_LOG_EXACT * WEIGHT_SCALE - WEIGHT_LOG_SCALED) / WEIGHT_SCALE
+                              + 1e-15L; // margin for the precision of WEIGHT_LOG_EXACT
+    for (long long d = 1; d <= WEIGHT_MAX_LOG_PART; d++) {
+        long double x = WEIGHT_LOG_EXACT * d; 
+        long double fraction = x - (long long)x; 
+        long double distance = (fraction < 0.5L) ? fraction : 1.0L - fraction; 
+        if (distance <= 2 * d * error)
+            return false; 
+    }
+    return (WEIGHT_MAX_INTEGER * (long double)WEIGHT_SCALE 
+            + WEIGHT_MAX_LOG_PART * (long double)WEIGHT_LOG_SCALED) * 2 
+           < 9.2e18L; // two keys still fit in a long long
+}
+
+static_assert(isFixedPointWeightOrderingExact(), 
+              "the fixed-point key does not order the weights exactly"); 
+
 /** Exception with a string expressing the reason.
   */
 class Exception {
@@ -88,9 +130,36 @@ class Weight {
             return Weight(scalar * integer, scalar * logPart);
         }
 
+        /** It returns the exact fixed-point key of the weight, 
+          * ie (integer + LOG * logPart) * 2^WEIGHT_SCALE_BITS up to a rounding 
+          * that never changes the order between two weights.
+          */
+        long long fixedPoint() const
+        {
+            assert(integer <= WEIGHT_MAX_INTEGER);
+            assert(logPart <= WEIGHT_MAX_LOG_PART); 
+            return ((long long)integer << WEIGHT_SCALE_BITS) 
+                   + (long long)logPart * WEIGHT_LOG_SCALED;
+        }
+
         bool operator < (const Weight& other) const
         {
-            return ((long double)*this < (long double)other);
+            return (fixedPoint() < other.fixedPoint());
+        }
+
+        bool operator <= (const Weight& other) const
+        {
+            return (fixedPoint() <= other.fixedPoint());
+        }
+
+        bool operator > (const Weight& other) const
+        {
+            return (other < *this);
+        }
+
+        bool operator == (const Weight& other) const
+        {
+            return (integer == other.integer && logPart == other.logPart);
         }
 
         bool operator != (const Weight& other) const
@@ -101,4 +170,59 @@ class Weight {
         friend ostream & operator << (ostream &fout, const Weight &aWeight); 
 };
 
+/** This class is used to store a bound on the weight, eg the maximum weight 
+  * of an extension. Unlike a Weight, it can be negative and it is not 
+  * necessarily of the form integer + LOG * logPart, so it is stored as a 
+  * fixed-point key comparable with Weight::fixedPoint(). 
+  */
+class WeightBound {
+    public:
+        long long scaled; 
+    public:
+        WeightBound(): scaled(0) {}
+
+        WeightBound(const Weight& aWeight): scaled(aWeight.fixedPoint()) {}
+
+        /** A real bound is rounded to the nearest fixed-point value, which is
+          * exact for integer bounds. 
+          */
+        explicit WeightBound(long double aBound): scaled(llroundl(aBound * WEIGHT_SCALE)) {}
+
+        explicit operator double long() const
+        {
+            return (long double)scaled / WEIGHT_SCALE;
+        }
+
+        WeightBound operator + (const Weight& aWeight) const
+        {
+            WeightBound result; 
+            result.scaled = scaled + aWeight.fixedPoint(); 
+            return result; 
+        }
+
+        WeightBound operator - (const Weight& aWeight) const
+        {
+            WeightBound result; 
+            result.scaled = scaled - aWeight.fixedPoint(); 
+            return result; 
+        }
+
+        bool operator < (const WeightBound& other) const
+        {
+            return (scaled < other.scaled);
+        }
+
+        friend bool operator <= (const Weight& aWeight, const WeightBound& aBound)
+        {
+            return (aWeight.fixedPoint() <= aBound.scaled);
+        }
+
+        friend bool operator > (const Weight& aWeight, const WeightBound& aBound)
+        {
+            return (aWeight.fixedPoint() > aBound.scaled);
+        }
+
+        friend ostream & operator << (ostream &fout, const WeightBound &aBound); 
+};
+
 #endif 